@@ -61,6 +61,9 @@ set(TASK1_EXCLUDE_REGEX "^performance/.*")
 # 实验一测例表，非空时忽略 EXCLUDE_REGEX
 set(TASK1_CASES_TXT "")
 
+# 是否构建实验二的微基准（task/2/bench），ON或OFF
+set(TASK2_BENCH OFF)
+
 # 实验二排除测例名的正则式
 set(TASK2_EXCLUDE_REGEX "^performance/.*")
 # 实验二测例表，非空时忽略 EXCLUDE_REGEX
@@ -1,28 +1,7 @@
 #include "SYsULexer.h" // 确保这里的头文件名与您生成的词法分析器匹配
+#include "TokenKinds.hpp"
 #include <fstream>
 #include <iostream>
-#include <unordered_map>
-
-// 映射定义，将ANTLR的tokenTypeName映射到clang的格式
-std::unordered_map<std::string, std::string> tokenTypeMapping = {
-  { "Int", "int" },
-  { "Identifier", "identifier" },
-  { "LeftParen", "l_paren" },
-  { "RightParen", "r_paren" },
-  { "RightBrace", "r_brace" },
-  { "LeftBrace", "l_brace" },
-  { "LeftBracket", "l_square" },
-  { "RightBracket", "r_square" },
-  { "Constant", "numeric_constant" },
-  { "Return", "return" },
-  { "Semi", "semi" },
-  { "EOF", "eof" },
-  { "Equal", "equal" },
-  { "Plus", "plus" },
-  { "Comma", "comma" },
-
-  // 在这里继续添加其他映射
-};
 
 void
 print_token(const antlr4::Token* token,
@@ -32,15 +11,15 @@ print_token(const antlr4::Token* token,
 {
   auto& vocabulary = lexer.getVocabulary();
 
-  auto tokenTypeName =
-    std::string(vocabulary.getSymbolicName(token->getType()));
+  // ANTLR 的规则名经编译期构造的完美哈希映射到 clang 的种类名，查找时不分配
+  // 内存。新的映射请添加到 TokenKinds.hpp 的 kTokenInfos 中
+  auto symbolicName = vocabulary.getSymbolicName(token->getType());
+  auto tokenTypeName = clang_name(antlr_kind(symbolicName));
 
+  if (tokenTypeName.empty()) // 没有对应的种类时原样输出规则名
+    tokenTypeName = symbolicName;
   if (tokenTypeName.empty())
     tokenTypeName = "<UNKNOWN>"; // 处理可能的空字符串情况
-
-  if (tokenTypeMapping.find(tokenTypeName) != tokenTypeMapping.end()) {
-    tokenTypeName = tokenTypeMapping[tokenTypeName];
-  }
   std::string locInfo = " Loc=<0:0>";
 
   bool startOfLine = false;
@@ -1,5 +1,11 @@
 #include "lex.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
 #include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 void
 print_token();
@@ -30,18 +36,149 @@ id2str(Id id)
 
 G g;
 
+Source::~Source()
+{
+  if (mMapped)
+    munmap(mData, mMapped);
+  else
+    std::free(mData);
+}
+
+bool
+Source::open(const char* path)
+{
+  int fd = ::open(path, O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+    std::size_t size = st.st_size;
+    std::size_t page = sysconf(_SC_PAGESIZE);
+    std::size_t mapped = (size + 2 + page - 1) / page * page;
+
+    // 先占一块全零的匿名映射，再把文件覆盖映射到开头，这样即使文件长度恰好
+    // 是页的整数倍，末尾的两个 '\0' 也落在匿名页中。映射是私有可写的，flex
+    // 临时改写的字符不会写回文件。
+    auto base = mmap(nullptr, mapped, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base != MAP_FAILED) {
+      if (size == 0 || mmap(base, size, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_FIXED, fd, 0) != MAP_FAILED) {
+        close(fd);
+        mData = static_cast<char*>(base), mSize = size + 2, mMapped = mapped;
+        return true;
+      }
+      munmap(base, mapped);
+    }
+  }
+
+  // 无法映射时退回整个读进内存
+  std::size_t cap = 1 << 16, size = 0;
+  auto data = static_cast<char*>(std::malloc(cap));
+  if (!data) {
+    close(fd);
+    return false;
+  }
+  while (true) {
+    if (cap - size <= 2) {
+      // realloc 失败时原来的块仍然有效，先放在临时变量里，免得丢掉它
+      auto grown = static_cast<char*>(std::realloc(data, cap * 2));
+      if (!grown) {
+        close(fd);
+        std::free(data);
+        return false;
+      }
+      data = grown, cap *= 2;
+    }
+    auto n = read(fd, data + size, cap - size - 2);
+    if (n < 0) {
+      close(fd);
+      std::free(data);
+      return false;
+    }
+    if (n == 0)
+      break;
+    size += n;
+  }
+  close(fd);
+  data[size] = data[size + 1] = '\0';
+  mData = data, mSize = size + 2, mMapped = 0;
+  return true;
+}
+
 int
-come(int tokenId, const char* yytext, int yyleng, int yylineno)
+come(int tokenId, const char* yytext, int yyleng)
 {
   g.mId = Id(tokenId);
   g.mText = { yytext, std::size_t(yyleng) };
-  g.mLine = yylineno;
 
   print_token();
+  g.mColumn += yyleng;
   g.mStartOfLine = false;
   g.mLeadingSpace = false;
 
   return tokenId;
 }
 
+void
+space(const char* yytext, int yyleng)
+{
+  // 用 memchr 逐个跳到换行符，它在常见的 C 库中都是向量化实现的
+  auto end = yytext + yyleng;
+  const char* last = nullptr;
+  int lines = 0;
+  for (auto p = yytext;
+       (p = static_cast<const char*>(std::memchr(p, '\n', end - p)));
+       ++p)
+    last = p, ++lines;
+
+  if (lines == 0) {
+    g.mColumn += yyleng;
+    g.mLeadingSpace = true;
+    return;
+  }
+
+  auto tail = int(end - last - 1); // 最后一个换行之后的空白
+  g.mLine += lines;
+  g.mColumn = 1 + tail;
+  g.mStartOfLine = true;
+  g.mLeadingSpace = tail > 0;
+}
+
+void
+line_marker(const char* yytext, int yyleng)
+{
+  auto p = yytext + 1, end = yytext + yyleng;
+  auto skip_spaces = [&]() {
+    while (p != end && (*p == ' ' || *p == '\t'))
+      ++p;
+  };
+
+  skip_spaces();
+  if (end - p >= 4 && std::memcmp(p, "line", 4) == 0) {
+    p += 4;
+    skip_spaces();
+  }
+
+  if (p == end || *p < '0' || *p > '9')
+    return; // 不是行标记，例如 #pragma
+  int line = 0;
+  while (p != end && '0' <= *p && *p <= '9')
+    line = line * 10 + (*p++ - '0');
+
+  skip_spaces();
+  if (p != end && *p == '"') {
+    g.mFile.clear();
+    for (++p; p != end && *p != '"'; ++p) {
+      if (*p == '\\' && p + 1 != end)
+        ++p; // 文件名中的反斜杠和引号是转义过的
+      g.mFile.push_back(*p);
+    }
+  }
+
+  // 标记之后的换行会把行号推进到标记所指的行
+  g.mLine = line - 1;
+}
+
 } // namespace lex
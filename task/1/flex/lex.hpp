@@ -42,9 +42,42 @@ struct G
   bool mLeadingSpace{ false };  // 是否有前导空格
 };
 
+/**
+ * @brief 输入源文件
+ *
+ * 普通文件以内存映射的方式读入，不能映射的（例如管道）则整个读进内存。
+ * 无论哪种方式，缓冲区末尾都带有 yy_scan_buffer 要求的两个 '\0'，并且在
+ * 对象析构前一直有效，因此 G::mText 可以直接指向其中而不必复制。
+ */
+struct Source
+{
+  char* mData{ nullptr }; ///< 缓冲区，flex 扫描时会临时改写其中的字符
+  std::size_t mSize{ 0 }; ///< 缓冲区长度，包括末尾的两个 '\0'
+
+  Source() = default;
+  Source(const Source&) = delete;
+  void operator=(const Source&) = delete;
+  ~Source();
+
+  /// 打开 \p path ，失败时返回 false
+  bool open(const char* path);
+
+private:
+  std::size_t mMapped{ 0 }; ///< 映射区长度，为 0 表示缓冲区由 malloc 分配
+};
+
 extern G g;
 
+/// 记录并输出一个词法单元，然后把列号推进到它的末尾
 int
-come(int tokenId, const char* yytext, int yyleng, int yylineno);
+come(int tokenId, const char* yytext, int yyleng);
+
+/// 跳过一整段空白，更新行号、列号以及行首、前导空格标记
+void
+space(const char* yytext, int yyleng);
+
+/// 处理预处理留下的行标记 `# 行号 "文件名" 标志...`，其它 # 开头的行忽略
+void
+line_marker(const char* yytext, int yyleng);
 
 } // namespace lex
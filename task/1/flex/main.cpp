@@ -1,63 +1,146 @@
 #include "lex.hpp"
 #include "lex.l.hh"
-#include <fstream>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
+#include <memory>
 
-static std::ofstream outFile;
-
-static std::string
-escape(std::string_view sv)
+/**
+ * @brief 词法分析结果的输出缓冲
+ *
+ * 每个记号的输出都直接追加到一块复用的大缓冲区中，转义也在缓冲区里就地完
+ * 成，只有缓冲区写满或者词法分析结束时才整块写入文件，从而避免每个记号都
+ * 构造临时字符串并触发一次系统调用。
+ */
+class Printer
 {
-  std::string result;
-  for (char c : sv) {
-    switch (c) {
-      case '\n':
-        result += "\\n";
-        break;
-      case '\t':
-        result += "\\t";
-        break;
-      case '\r':
-        result += "\\r";
-        break;
-      case '\v':
-        result += "\\v";
-        break;
-      case '\f':
-        result += "\\f";
-        break;
-      case '\a':
-        result += "\\a";
-        break;
-      case '\b':
-        result += "\\b";
-        break;
-      case '\\':
-        result += "\\\\";
-        break;
-      case '\'':
-        result += "\\\'";
-        break;
-      case '\0':
-        break;
-      default:
-        result += c;
-        break;
+public:
+  static constexpr std::size_t kCapacity = std::size_t(1) << 20;
+
+  std::size_t mTokens{ 0 }; ///< 已输出的记号数
+
+  bool open(const char* path)
+  {
+    mFile = std::fopen(path, "wb");
+    if (!mFile)
+      return false;
+    std::setvbuf(mFile, nullptr, _IONBF, 0); // 缓冲由本类负责
+    mBuf.reset(new char[kCapacity]);
+    return true;
+  }
+
+  void close()
+  {
+    if (!mFile)
+      return;
+    flush();
+    std::fclose(mFile);
+    mFile = nullptr;
+  }
+
+  ~Printer() { close(); }
+
+  void put(std::string_view sv)
+  {
+    while (kCapacity - mSize < sv.size()) {
+      auto n = kCapacity - mSize;
+      std::memcpy(mBuf.get() + mSize, sv.data(), n);
+      mSize += n, sv.remove_prefix(n);
+      flush();
+    }
+    std::memcpy(mBuf.get() + mSize, sv.data(), sv.size());
+    mSize += sv.size();
+  }
+
+  void put_int(int val)
+  {
+    char buf[16];
+    auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), val);
+    put({ buf, std::size_t(end - buf) });
+  }
+
+  void put_escaped(std::string_view sv)
+  {
+    for (char c : sv) {
+      // 每个字符转义后至多占两个字节
+      if (kCapacity - mSize < 2)
+        flush();
+
+      char e;
+      switch (c) {
+        case '\n':
+          e = 'n';
+          break;
+        case '\t':
+          e = 't';
+          break;
+        case '\r':
+          e = 'r';
+          break;
+        case '\v':
+          e = 'v';
+          break;
+        case '\f':
+          e = 'f';
+          break;
+        case '\a':
+          e = 'a';
+          break;
+        case '\b':
+          e = 'b';
+          break;
+        case '\\':
+          e = '\\';
+          break;
+        case '\'':
+          e = '\'';
+          break;
+        case '\0':
+          continue;
+        default:
+          mBuf[mSize++] = c;
+          continue;
+      }
+      mBuf[mSize++] = '\\';
+      mBuf[mSize++] = e;
     }
   }
-  return result;
-}
+
+  void flush()
+  {
+    std::fwrite(mBuf.get(), 1, mSize, mFile);
+    mSize = 0;
+  }
+
+private:
+  std::FILE* mFile{ nullptr };
+  std::unique_ptr<char[]> mBuf;
+  std::size_t mSize{ 0 };
+};
+
+static Printer gPrinter;
 
 void
 print_token()
 {
-  outFile << lex::id2str(lex::g.mId) << " \'" << escape(lex::g.mText) << "\'";
+  gPrinter.put(lex::id2str(lex::g.mId));
+  gPrinter.put(" \'");
+  gPrinter.put_escaped(lex::g.mText);
+  gPrinter.put("\'");
   if (lex::g.mStartOfLine)
-    outFile << "\t[StartOfLine]";
+    gPrinter.put("\t[StartOfLine]");
   if (lex::g.mLeadingSpace)
-    outFile << "\t[LeadingSpace]";
-  outFile << "\tLoc=<0:0>\n";
-  outFile << std::flush;
+    gPrinter.put("\t[LeadingSpace]");
+  gPrinter.put("\tLoc=<");
+  gPrinter.put(lex::g.mFile);
+  gPrinter.put(":");
+  gPrinter.put_int(lex::g.mLine);
+  gPrinter.put(":");
+  gPrinter.put_int(lex::g.mColumn);
+  gPrinter.put(">\n");
+  ++gPrinter.mTokens;
 }
 
 int
@@ -68,14 +151,16 @@ main(int argc, char* argv[])
     return -1;
   }
 
-  yyin = fopen(argv[1], "r");
-  if (!yyin) {
+  // 输入文件映射到内存后交给 flex 直接扫描，不再经过 stdio 分块读取
+  lex::Source source;
+  if (!source.open(argv[1])) {
     std::cerr << "Failed to open " << argv[1] << '\n';
     return -2;
   }
+  auto buffer = yy_scan_buffer(source.mData, source.mSize);
+  lex::g.mFile = argv[1]; // 没有行标记时以输入文件本身定位
 
-  outFile = std::ofstream(argv[2]);
-  if (!outFile) {
+  if (!gPrinter.open(argv[2])) {
     std::cerr << "Failed to open " << argv[2] << '\n';
     return -3;
   }
@@ -86,8 +171,18 @@ main(int argc, char* argv[])
 
   // 这个循环完成词法分析，yylex()中会调用print_token()，从而向
   // 输出文件中写入词法分析结果。
+  auto begin = std::chrono::steady_clock::now();
   while (yylex())
     ;
+  gPrinter.close();
+  auto end = std::chrono::steady_clock::now();
+
+  yy_delete_buffer(buffer);
 
-  fclose(yyin);
+  double secs = std::chrono::duration<double>(end - begin).count();
+  std::cout << "记号 " << gPrinter.mTokens << " 个，用时 " << secs * 1000
+            << " ms";
+  if (secs > 0)
+    std::cout << "，" << std::size_t(gPrinter.mTokens / secs) << " 个/秒";
+  std::cout << std::endl;
 }
@@ -5,34 +5,6 @@
 
 namespace asg {
 
-// 符号表，保存当前作用域的所有声明
-struct Ast2Asg::Symtbl : public std::unordered_map<std::string, Decl*>
-{
-  Ast2Asg& m;
-  Symtbl* mPrev;
-
-  Symtbl(Ast2Asg& m)
-    : m(m)
-    , mPrev(m.mSymtbl)
-  {
-    m.mSymtbl = this;
-  }
-
-  ~Symtbl() { m.mSymtbl = mPrev; }
-
-  Decl* resolve(const std::string& name);
-};
-
-Decl*
-Ast2Asg::Symtbl::resolve(const std::string& name)
-{
-  auto iter = find(name);
-  if (iter != end())
-    return iter->second;
-  ASSERT(mPrev != nullptr); // 标识符未定义
-  return mPrev->resolve(name);
-}
-
 TranslationUnit*
 Ast2Asg::operator()(ast::TranslationUnitContext* ctx)
 {
@@ -40,7 +12,7 @@ Ast2Asg::operator()(ast::TranslationUnitContext* ctx)
   if (ctx == nullptr)
     return ret;
 
-  Symtbl localDecls(self);
+  Symtbl::Scope localDecls(mSymtbl);
 
   for (auto&& i : ctx->externalDeclaration()) {
     if (auto p = i->declaration()) {
@@ -55,7 +27,7 @@ Ast2Asg::operator()(ast::TranslationUnitContext* ctx)
       ret->decls.push_back(funcDecl);
 
       // 添加到声明表
-      localDecls[funcDecl->name] = funcDecl;
+      mSymtbl.declare(funcDecl->name, funcDecl);
     }
 
     else
@@ -297,7 +269,8 @@ Ast2Asg::operator()(ast::PrimaryExpressionContext* ctx)
   if (auto p = ctx->Identifier()) {
     auto name = p->getText();
     auto ret = make<DeclRefExpr>();
-    ret->decl = mSymtbl->resolve(name);
+    ret->decl = mSymtbl.resolve(name);
+    ASSERT(ret->decl != nullptr); // 标识符未定义
     return ret;
   }
 
@@ -374,7 +347,7 @@ Ast2Asg::operator()(ast::CompoundStatementContext* ctx)
   auto ret = make<CompoundStmt>();
 
   if (auto p = ctx->blockItemList()) {
-    Symtbl localDecls(self);
+    Symtbl::Scope localDecls(mSymtbl);
 
     for (auto&& i : p->blockItem()) {
       if (auto q = i->declaration()) {
@@ -458,10 +431,10 @@ Ast2Asg::operator()(ast::FunctionDefinitionContext* ctx)
   type->texp = funcType;
   ret->name = std::move(name);
 
-  Symtbl localDecls(self);
+  Symtbl::Scope localDecls(mSymtbl);
 
   // 函数定义在签名之后就加入符号表，以允许递归调用
-  (*mSymtbl)[ret->name] = ret;
+  mSymtbl.declare(ret->name, ret);
 
   ret->body = self(ctx->compoundStatement());
 
@@ -516,7 +489,7 @@ Ast2Asg::operator()(ast::InitDeclaratorContext* ctx, SpecQual sq)
   }
 
   // 这个实现允许符号重复定义，新定义会取代旧定义
-  (*mSymtbl)[ret->name] = ret;
+  mSymtbl.declare(ret->name, ret);
   return ret;
 }
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "SYsUParser.h"
+#include "Symtbl.hpp"
 #include "asg.hpp"
 
 namespace asg {
@@ -75,8 +76,7 @@ public:
   Decl* operator()(ast::InitDeclaratorContext* ctx, SpecQual sq);
 
 private:
-  struct Symtbl;
-  Symtbl* mSymtbl{ nullptr };
+  Symtbl mSymtbl;
 
   FunctionDecl* mCurrentFunc{ nullptr };
 
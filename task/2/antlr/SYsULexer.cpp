@@ -1,6 +1,6 @@
 #include "SYsULexer.hpp"
 #include "SYsULexer.tokens.hpp"
-#include <unordered_map>
+#include "TokenKinds.hpp"
 #include <vector>
 
 using antlr4::ParseCancellationException;
@@ -10,118 +10,98 @@ namespace {
 
 using namespace SYsULexerTokens;
 
-static const std::unordered_map<std::string, size_t> kClangTokens{
-  { "eof", antlr4::Token::EOF },
-  { "int", kInt },
-  { "identifier", kIdentifier },
-  { "l_paren", kLeftParen },
-  { "r_paren", kRightParen },
-  { "return", kReturn },
-  { "r_brace", kRightBrace },
-  { "l_brace", kLeftBrace },
-  { "numeric_constant", kConstant },
-  { "semi", kSemi },
-  { "equal", kEqual },
-  { "plus", kPlus },
-  { "minus", kMinus },
-  { "comma", kComma },
-  { "l_square", kLeftBracket },
-  { "r_square", kRightBracket }
+/// 种类 -> 词法单元类型，没有列出的种类为 INVALID_TYPE
+constexpr std::pair<TokenKind, size_t> kClangTokenPairs[] = {
+  { TokenKind::kEof, antlr4::Token::EOF },
+  { TokenKind::kInt, kInt },
+  { TokenKind::kIdentifier, kIdentifier },
+  { TokenKind::kLParen, kLeftParen },
+  { TokenKind::kRParen, kRightParen },
+  { TokenKind::kReturn, kReturn },
+  { TokenKind::kRBrace, kRightBrace },
+  { TokenKind::kLBrace, kLeftBrace },
+  { TokenKind::kNumericConstant, kConstant },
+  { TokenKind::kSemi, kSemi },
+  { TokenKind::kEqual, kEqual },
+  { TokenKind::kPlus, kPlus },
+  { TokenKind::kMinus, kMinus },
+  { TokenKind::kComma, kComma },
+  { TokenKind::kLSquare, kLeftBracket },
+  { TokenKind::kRSquare, kRightBracket }
 };
 
+constexpr auto kClangTokens =
+  token_table<size_t>(antlr4::Token::INVALID_TYPE, kClangTokenPairs);
+
+/// clang 的种类名对应的词法单元类型，经编译期构造的完美哈希查找
+size_t
+token_type(std::string_view name)
+{
+  auto type = kClangTokens[std::size_t(clang_kind(name))];
+  assert(type != antlr4::Token::INVALID_TYPE);
+  return type;
+}
+
 } // namespace
 
-SYsULexer::SYsULexer(antlr4::CharStream* input)
+SYsULexer::SYsULexer(antlr4::CharStream* input, std::string_view dump)
   : mInput(input)
   , mSource(make_pair(this, input))
   , mFactory(antlr4::CommonTokenFactory::DEFAULT.get())
   , mSourceName(input->getSourceName())
+  , mBinary(mDump.open(dump.data(), dump.size()))
+  , mReader(dump.data(), dump.size())
 {
+  // 种类名在打开时映射一次，之后按种类表下标查表
+  if (!mBinary)
+    return;
+  for (std::uint32_t i = 0; i < mDump.kinds(); ++i)
+    mKindTypes.push_back(token_type(mDump.kind(i)));
 }
 
 std::unique_ptr<antlr4::Token>
 SYsULexer::nextToken()
 {
-  auto c = mInput->LA(1);
-  if (c == antlr4::Token::EOF) {
-    // 到达文件末尾，退出循环
-    return common_token(antlr4::Token::EOF, mInput->index(), mInput->index());
+  if (mBinary)
+    return next_record();
+
+  // 字段都是指向输入的 string_view，只有交给 ANTLR 的文本需要复制
+  DumpReader::Token tok;
+  if (!mReader.next(tok)) {
+    // 文本到达末尾，或者遇到了无法解析的行
+    assert(!mReader.error());
+    return common_token(antlr4::Token::EOF, mNext, mNext);
   }
 
-  auto start = mInput->index();
-  std::string line;
-  while (true) {
-    mInput->consume();
-    if (c == U'\n') {
-      if (mInput->LA(1) == U'\r')
-        mInput->consume();
-      break;
-    }
-    if (c == U'\r') {
-      if (mInput->LA(1) == U'\n')
-        mInput->consume();
-      break;
-    }
-    line.push_back(c);
-    c = mInput->LA(1);
-    if (c == antlr4::Token::EOF)
-      return common_token(antlr4::Token::INVALID_TYPE, start, mInput->index());
-  }
-  auto stop = mInput->index();
-
-  std::size_t typeEnd, type;
-  std::size_t textEnd;
-  std::string text;
-
-  // 提取类型段
-  {
-    decltype(kClangTokens)::const_iterator typeIter;
-    typeEnd = line.find(' ');
-    if (typeEnd == std::string::npos)
-      goto FAIL;
-    typeIter = kClangTokens.find(line.substr(0, typeEnd));
-    if (typeIter == kClangTokens.end())
-      goto FAIL;
-    type = typeIter->second;
+  auto type = token_type(tok.mKind);
+  if (tok.mFile != mFile) {
+    mFile = tok.mFile;
+    mSourceName = mFile.str();
   }
+  mLine = tok.mLine;
+  mColumn = tok.mColumn;
 
-  // 提取文本段
-  {
-    textEnd = line.find('\t', typeEnd + 1);
-    if (textEnd == std::string::npos ||
-        textEnd < typeEnd + 3 // 至少要有一对空引号 ''
-    )
-      goto FAIL;
-    text = line.substr(typeEnd + 2, textEnd - typeEnd - 3);
-  }
+  auto index = mNext++;
+  return common_token(type, index, index, std::string(tok.mText));
+}
 
-  // 提取位置段
-  {
-    std::size_t locStart, locEnd, colStart, rowStart;
-
-    locStart = line.find("Loc=<", textEnd + 1);
-    if (locStart == std::string::npos)
-      goto FAIL;
-    locEnd = line.rfind(">");
-    if (locEnd == std::string::npos)
-      goto FAIL;
-    colStart = line.rfind(':', locEnd);
-    if (colStart == std::string::npos)
-      goto FAIL;
-    rowStart = line.rfind(':', colStart - 1);
-    if (rowStart == std::string::npos)
-      goto FAIL;
-
-    mSourceName = line.substr(locStart + 5, rowStart - locStart - 5);
-    mLine = std::stoul(line.substr(rowStart + 1, colStart - rowStart - 1));
-    mColumn = std::stoul(line.substr(colStart + 1, locEnd - colStart - 1));
+std::unique_ptr<antlr4::Token>
+SYsULexer::next_record()
+{
+  if (mNext == mDump.size())
+    return common_token(antlr4::Token::EOF, mNext, mNext);
+
+  // 序号充当词法单元在输入中的位置
+  auto index = mNext++;
+  auto& rec = mDump[index];
+  if (rec.mFile != mFileOffset) {
+    mFileOffset = rec.mFile;
+    mSourceName = mDump.str(rec.mFile);
   }
-
-  // 解析成功
-  return common_token(type, start, stop, text);
-
-FAIL: // 解析失败
-  assert(false);
+  mLine = rec.mLine;
+  mColumn = rec.mColumn;
+  return common_token(
+    mKindTypes[rec.mKind], index, index, std::string(mDump.str(rec.mText)));
 }
 
 size_t
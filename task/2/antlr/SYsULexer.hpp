@@ -1,15 +1,21 @@
 #pragma once
 
+#include "DumpReader.hpp"
+#include "TokenDump.hpp"
 #include <antlr4-runtime.h>
 #include <deque>
 #include <memory>
 #include <stack>
 #include <string>
+#include <string_view>
+#include <vector>
 
 class SYsULexer : public antlr4::TokenSource
 {
 public:
-  SYsULexer(antlr4::CharStream* input);
+  /// \p dump 是整个输入文件的内容，文本和二进制格式均可，在词法分析期间
+  /// 必须保持有效。\p input 只用作词法单元的来源，通常是一个空的字符流。
+  SYsULexer(antlr4::CharStream* input, std::string_view dump);
 
   std::unique_ptr<antlr4::Token> nextToken() override;
 
@@ -37,6 +43,16 @@ private:
   std::string mSourceName;
   size_t mLine = 1, mColumn = 0;
 
+  TokenDump mDump;
+  bool mBinary = false;           ///< 输入是否为二进制格式
+  DumpReader mReader;             ///< 文本格式的读取器
+  std::uint32_t mNext = 0;        ///< 下一个词法单元的序号
+  std::uint32_t mFileOffset = -1; ///< mSourceName 在字符串表中的偏移
+  Atom mFile{};                   ///< mSourceName 驻留后的原子
+  std::vector<size_t> mKindTypes; ///< 种类表下标 -> 词法单元类型
+
+  std::unique_ptr<antlr4::Token> next_record();
+
   std::unique_ptr<antlr4::CommonToken> common_token(size_t type,
                                                     size_t start,
                                                     size_t stop,
@@ -1,20 +1,26 @@
 #include "Asg2Json.hpp"
 #include "Ast2Asg.hpp"
 #include "SYsULexer.hpp"
+#include "TokenDump.hpp"
 #include "Typing.hpp"
 #include "asg.hpp"
-#include <fstream>
 #include <iostream>
+#include <llvm/Support/MemoryBuffer.h>
 
 int
 main(int argc, char* argv[])
 {
+  if (argc == 4 && std::string(argv[1]) == "--pack")
+    return TokenDump::pack(argv[2], argv[3]);
+
   if (argc != 3) {
-    std::cout << "Usage: " << argv[0] << " <input> <output>\n";
+    std::cout << "Usage: " << argv[0] << " <input> <output>\n"
+              << "       " << argv[0] << " --pack <dump> <output>\n";
     return -1;
   }
 
-  std::ifstream inFile(argv[1]);
+  // 不要求末尾有 '\0'，这样 MemoryBuffer 总能以内存映射的方式读入大文件
+  auto inFile = llvm::MemoryBuffer::getFile(argv[1], false, false);
   if (!inFile) {
     std::cout << "Error: unable to open input file: " << argv[1] << '\n';
     return -2;
@@ -32,26 +38,28 @@ main(int argc, char* argv[])
   std::cout << "输入 " << argv[1] << std::endl;
   std::cout << "输出 " << argv[2] << std::endl;
 
-  antlr4::ANTLRInputStream input(inFile);
-  SYsULexer lexer(&input);
+  // 词法单元直接从文件内容中读取，字符流为空，只用作词法单元的来源
+  antlr4::ANTLRInputStream input;
+  SYsULexer lexer(&input, (*inFile)->getBuffer());
 
   antlr4::CommonTokenStream tokens(&lexer);
   SYsUParser parser(&tokens);
 
   auto ast = parser.compilationUnit();
-  Obj::Mgr mgr;
+  Obj::Mgr mgr(Obj::Mgr::Alloc::kArena);
 
   asg::Ast2Asg ast2asg(mgr);
   auto asg = ast2asg(ast->translationUnit());
   mgr.mRoot = asg;
-  mgr.gc();
+  mgr.gc().print(stderr, "语法分析后垃圾回收");
 
   asg::Typing inferType(mgr);
   inferType(asg);
-  mgr.gc();
+  inferType.mTypeCache.clear();
+  mgr.gc().print(stderr, "类型检查后垃圾回收");
 
   asg::Asg2Json asg2json;
-  llvm::json::Value json = asg2json(asg);
+  asg2json(asg, outFile);
 
-  outFile << json << '\n';
+  outFile << '\n';
 }
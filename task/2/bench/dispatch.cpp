@@ -0,0 +1,170 @@
+/**
+ * @file dispatch.cpp
+ * @brief 结点分派开销的微基准
+ *
+ * 按接近真实语义图的比例随机生成一批 Expr 结点，分别用 dynamic_cast 链（种类
+ * 标签引入之前的做法）和 asg::visit 的种类标签 switch 分派到同一组处理函数，
+ * 报告每个结点的平均耗时。
+ *
+ * 用法：task2-bench-dispatch [结点数] [轮数]，默认 1000000 个结点、20 轮。
+ */
+
+#include "asg.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace asg;
+
+namespace {
+
+/// 每种结点返回一个不同的值，使得两种分派的结果可以互相核对
+struct Handler
+{
+  std::uint64_t operator()(IntegerLiteral* p) { return p->val; }
+  std::uint64_t operator()(StringLiteral* p) { return p->val.size(); }
+  std::uint64_t operator()(DeclRefExpr* p) { return 3; }
+  std::uint64_t operator()(ParenExpr* p) { return 5; }
+  std::uint64_t operator()(UnaryExpr* p) { return p->op; }
+  std::uint64_t operator()(BinaryExpr* p) { return p->op; }
+  std::uint64_t operator()(CallExpr* p) { return p->args.size() + 7; }
+  std::uint64_t operator()(InitListExpr* p) { return p->list.size() + 11; }
+  std::uint64_t operator()(ImplicitInitExpr* p) { return 13; }
+  std::uint64_t operator()(ImplicitCastExpr* p) { return p->kind; }
+};
+
+/// 种类标签引入之前 Typing 等遍历器的写法
+std::uint64_t
+dispatch_dynamic_cast(Handler& h, Expr* obj)
+{
+  if (auto p = dynamic_cast<IntegerLiteral*>(obj))
+    return h(p);
+  if (auto p = dynamic_cast<StringLiteral*>(obj))
+    return h(p);
+  if (auto p = dynamic_cast<DeclRefExpr*>(obj))
+    return h(p);
+  if (auto p = dynamic_cast<ParenExpr*>(obj))
+    return h(p);
+  if (auto p = dynamic_cast<UnaryExpr*>(obj))
+    return h(p);
+  if (auto p = dynamic_cast<BinaryExpr*>(obj))
+    return h(p);
+  if (auto p = dynamic_cast<CallExpr*>(obj))
+    return h(p);
+  if (auto p = dynamic_cast<InitListExpr*>(obj))
+    return h(p);
+  if (auto p = dynamic_cast<ImplicitInitExpr*>(obj))
+    return h(p);
+  if (auto p = dynamic_cast<ImplicitCastExpr*>(obj))
+    return h(p);
+  ABORT();
+}
+
+std::uint64_t
+dispatch_visit(Handler& h, Expr* obj)
+{
+  return visit<std::uint64_t>(
+    obj, [&](auto p) -> decltype(h(p)) { return h(p); });
+}
+
+Expr*
+make_expr(Obj::Mgr& mgr, std::mt19937& rng)
+{
+  // 各种结点所占的比例（百分比），大致按测例中的语义图统计
+  static std::discrete_distribution<int> dist(
+    { 15, 2, 25, 3, 3, 15, 4, 2, 1, 30 });
+
+  switch (dist(rng)) {
+    case 0: {
+      auto p = mgr.make<IntegerLiteral>();
+      p->val = rng() % 100;
+      return p;
+    }
+    case 1: {
+      auto p = mgr.make<StringLiteral>();
+      p->val = "hello";
+      return p;
+    }
+    case 2:
+      return mgr.make<DeclRefExpr>();
+    case 3:
+      return mgr.make<ParenExpr>();
+    case 4: {
+      auto p = mgr.make<UnaryExpr>();
+      p->op = UnaryExpr::kNeg;
+      return p;
+    }
+    case 5: {
+      auto p = mgr.make<BinaryExpr>();
+      p->op = BinaryExpr::Op(1 + rng() % BinaryExpr::kComma);
+      return p;
+    }
+    case 6:
+      return mgr.make<CallExpr>();
+    case 7:
+      return mgr.make<InitListExpr>();
+    case 8:
+      return mgr.make<ImplicitInitExpr>();
+    default: {
+      auto p = mgr.make<ImplicitCastExpr>();
+      p->kind = ImplicitCastExpr::kLValueToRValue;
+      return p;
+    }
+  }
+}
+
+template<typename F>
+double
+measure(const char* name,
+        const std::vector<Expr*>& exprs,
+        int rounds,
+        std::uint64_t& sum,
+        F dispatch)
+{
+  using Clock = std::chrono::steady_clock;
+  Handler h;
+  sum = 0;
+  auto start = Clock::now();
+  for (int r = 0; r < rounds; ++r)
+    for (auto e : exprs)
+      sum += dispatch(h, e);
+  std::chrono::duration<double, std::nano> ns = Clock::now() - start;
+  auto perNode = ns.count() / (double(exprs.size()) * rounds);
+  std::printf("%-14s %8.2f ns/结点  （校验和 %llu）\n",
+              name,
+              perNode,
+              static_cast<unsigned long long>(sum));
+  return perNode;
+}
+
+} // namespace
+
+int
+main(int argc, char* argv[])
+{
+  std::size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+  int rounds = argc > 2 ? std::atoi(argv[2]) : 20;
+
+  Obj::Mgr mgr(Obj::Mgr::Alloc::kArena);
+  std::mt19937 rng(20240501);
+  std::vector<Expr*> exprs;
+  exprs.reserve(count);
+  for (std::size_t i = 0; i < count; ++i)
+    exprs.push_back(make_expr(mgr, rng));
+
+  std::printf("%zu 个结点，%d 轮\n", count, rounds);
+  std::uint64_t sumCast, sumVisit;
+  auto cast = measure("dynamic_cast 链", exprs, rounds, sumCast,
+                      dispatch_dynamic_cast);
+  auto tag =
+    measure("种类标签 visit", exprs, rounds, sumVisit, dispatch_visit);
+
+  if (sumCast != sumVisit) {
+    std::printf("两种分派的结果不一致！\n");
+    return 1;
+  }
+  std::printf("加速比 %.1fx\n", cast / tag);
+  return 0;
+}
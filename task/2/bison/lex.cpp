@@ -1,45 +1,182 @@
 #include "lex.hpp"
+#include "TokenKinds.hpp"
+#include <cstdlib>
 #include <cstring>
+#include <fcntl.h>
 #include <iostream>
-#include <unordered_map>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace lex {
 
 G g;
 
+Source::~Source()
+{
+  if (mMapped)
+    munmap(mData, mMapped);
+  else
+    std::free(mData);
+}
+
+bool
+Source::open(const char* path)
+{
+  int fd = ::open(path, O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+    std::size_t size = st.st_size;
+    std::size_t page = sysconf(_SC_PAGESIZE);
+    std::size_t mapped = (size + 2 + page - 1) / page * page;
+
+    // 先占一块全零的匿名映射，再把文件覆盖映射到开头，这样即使文件长度恰好
+    // 是页的整数倍，末尾的两个 '\0' 也落在匿名页中。映射是私有可写的，flex
+    // 临时改写的字符不会写回文件。
+    auto base = mmap(nullptr, mapped, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base != MAP_FAILED) {
+      if (size == 0 || mmap(base, size, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_FIXED, fd, 0) != MAP_FAILED) {
+        close(fd);
+        mData = static_cast<char*>(base), mSize = size + 2, mMapped = mapped;
+        return true;
+      }
+      munmap(base, mapped);
+    }
+  }
+
+  // 无法映射时退回整个读进内存
+  std::size_t cap = 1 << 16, size = 0;
+  auto data = static_cast<char*>(std::malloc(cap));
+  if (!data) {
+    close(fd);
+    return false;
+  }
+  while (true) {
+    if (cap - size <= 2) {
+      // realloc 失败时原来的块仍然有效，先放在临时变量里，免得丢掉它
+      auto grown = static_cast<char*>(std::realloc(data, cap * 2));
+      if (!grown) {
+        close(fd);
+        std::free(data);
+        return false;
+      }
+      data = grown, cap *= 2;
+    }
+    auto n = read(fd, data + size, cap - size - 2);
+    if (n < 0) {
+      close(fd);
+      std::free(data);
+      return false;
+    }
+    if (n == 0)
+      break;
+    size += n;
+  }
+  close(fd);
+  data[size] = data[size + 1] = '\0';
+  mData = data, mSize = size + 2, mMapped = 0;
+  return true;
+}
+
+namespace {
+
+/// 种类 -> 词号，没有列出的种类为 YYUNDEF
+constexpr std::pair<TokenKind, int> kTokenIdPairs[] = {
+  { TokenKind::kIdentifier, IDENTIFIER },
+  { TokenKind::kNumericConstant, CONSTANT },
+  { TokenKind::kInt, INT },
+  { TokenKind::kVoid, VOID },
+  { TokenKind::kReturn, RETURN },
+  { TokenKind::kLParen, '(' },
+  { TokenKind::kRParen, ')' },
+  { TokenKind::kLBrace, '{' },
+  { TokenKind::kRBrace, '}' },
+  { TokenKind::kSemi, ';' },
+  { TokenKind::kEqual, '=' },
+  { TokenKind::kLSquare, '[' },
+  { TokenKind::kRSquare, ']' },
+  { TokenKind::kComma, ',' },
+  { TokenKind::kMinus, '-' },
+  { TokenKind::kPlus, '+' },
+  { TokenKind::kEof, YYEOF },
+  // TODO 添加其他的 token
+};
+
+constexpr auto kTokenIds = token_table<int>(YYUNDEF, kTokenIdPairs);
+
+int
+token_id(std::string_view name)
+{
+  // 种类名经编译期构造的完美哈希查找，不分配内存
+  auto id = kTokenIds[std::size_t(clang_kind(name))];
+  assert(id != YYUNDEF);
+  return id;
+}
+
+/// 设置词法单元的语义值
+void
+set_value(int id, std::string_view text)
+{
+  if (id == IDENTIFIER) {
+    // 标识符在词法分析时就驻留为原子，之后的各个阶段只比较编号
+    g.mAtom = Atom(text);
+    yylval.Name = g.mAtom;
+  } else if (id == CONSTANT)
+    yylval.RawStr = new std::string(text);
+}
+
+} // namespace
+
 int
 come_line(const char* yytext, int yyleng, int yylineno)
 {
-  char name[64];
-  char value[64];
-  sscanf(yytext, "%s '%[^']'", name, value);
-
-  static const std::unordered_map<std::string, int> kTokenId = {
-    { "identifier", IDENTIFIER },
-    { "numeric_constant", CONSTANT },
-    { "int", INT },
-    { "void", VOID },
-    { "return", RETURN },
-    { "l_paren", '(' },
-    { "r_paren", ')' },
-    { "l_brace", '{' },
-    { "r_brace", '}' },
-    { "semi", ';' },
-    { "equal", '=' },
-    { "l_square", '[' },
-    { "r_square", ']' },
-    { "comma", ',' },
-    { "minus", '-' },
-    { "plus", '+' },
-    { "eof", YYEOF },
-    // TODO 添加其他的 token
-  };
-
-  auto iter = kTokenId.find(name);
-  assert(iter != kTokenId.end());
-
-  yylval.RawStr = new std::string(value, strlen(value));
-  return iter->second;
+  // 字段都是指向输入缓冲区的 string_view，不再复制到定长的临时数组中
+  DumpReader::Token tok;
+  ASSERT(g.mReader.parse({ yytext, std::size_t(yyleng) }, tok));
+
+  g.mId = token_id(tok.mKind);
+  g.mText = tok.mText;
+  g.mFile = tok.mFile;
+  g.mLine = tok.mLine;
+  g.mColumn = tok.mColumn;
+  set_value(g.mId, g.mText);
+  return g.mId;
+}
+
+void
+open_dump(const TokenDump& dump)
+{
+  g.mDump = &dump;
+  g.mNext = 0;
+  g.mFileOffset = -1;
+  g.mKindIds.clear();
+  for (std::uint32_t i = 0; i < dump.kinds(); ++i)
+    g.mKindIds.push_back(token_id(dump.kind(i)));
+}
+
+int
+come_record()
+{
+  auto& dump = *g.mDump;
+  if (g.mNext == dump.size())
+    return YYEOF;
+
+  auto& rec = dump[g.mNext++];
+  g.mId = g.mKindIds[rec.mKind];
+  g.mText = dump.str(rec.mText);
+  if (rec.mFile != g.mFileOffset) {
+    g.mFileOffset = rec.mFile;
+    g.mFile = dump.str(rec.mFile);
+  }
+  g.mLine = rec.mLine;
+  g.mColumn = rec.mColumn;
+  set_value(g.mId, g.mText);
+  return g.mId;
 }
 
 int
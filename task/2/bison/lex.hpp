@@ -1,9 +1,13 @@
 #pragma once
 
+#include "Atom.hpp"
+#include "DumpReader.hpp"
+#include "TokenDump.hpp"
 #include "par.y.hh"
 #include <string>
 #include <string_view>
 #include <cstdio>
+#include <vector>
 
 namespace lex {
 
@@ -11,14 +15,53 @@ struct G
 {
   int mId{ YYEOF };             // 词号
   std::string_view mText;       // 对应文本
-  std::string mFile;            // 文件路径
+  Atom mAtom{};                 // 标识符驻留后的原子
+  Atom mFile{};                 // 文件路径
   int mLine{ 0 }, mColumn{ 0 }; // 行号、列号
   bool mStartOfLine{ true };    // 是否是行首
   bool mLeadingSpace{ false };  // 是否有前导空格
+
+  DumpReader mReader;                // 文本行的解析，保存上一行的文件名
+  const TokenDump* mDump{ nullptr }; // 二进制词法单元流，为空时扫描文本
+  std::uint32_t mNext{ 0 };          // 下一个要读取的记录
+  std::uint32_t mFileOffset = -1;    // mFile 在字符串表中的偏移
+  std::vector<int> mKindIds;         // 种类表下标 -> 词号
+};
+
+/**
+ * @brief 输入源文件
+ *
+ * 普通文件以内存映射的方式读入，不能映射的（例如管道）则整个读进内存。
+ * 无论哪种方式，缓冲区末尾都带有 yy_scan_buffer 要求的两个 '\0'，并且在
+ * 对象析构前一直有效，因此 G::mText 可以直接指向其中而不必复制。
+ */
+struct Source
+{
+  char* mData{ nullptr }; ///< 缓冲区，flex 扫描时会临时改写其中的字符
+  std::size_t mSize{ 0 }; ///< 缓冲区长度，包括末尾的两个 '\0'
+
+  Source() = default;
+  Source(const Source&) = delete;
+  void operator=(const Source&) = delete;
+  ~Source();
+
+  /// 打开 \p path ，失败时返回 false
+  bool open(const char* path);
+
+private:
+  std::size_t mMapped{ 0 }; ///< 映射区长度，为 0 表示缓冲区由 malloc 分配
 };
 
 extern G g;
 
+/// 改为从二进制词法单元流 \p dump 中读取，此后 yylex 不再扫描输入缓冲区
+void
+open_dump(const TokenDump& dump);
+
+/// 从二进制词法单元流中取出下一个词法单元
+int
+come_record();
+
 int
 come_line(const char* yytext, int yyleng, int yylineno);
 
@@ -1,55 +1,135 @@
 #include "Asg2Json.hpp"
+#include "TokenDump.hpp"
 #include "Typing.hpp"
+#include "lex.hpp"
 #include "lex.l.hh"
 #include "par.y.hh"
+#include <chrono>
 #include <fstream>
 #include <iostream>
+#include <llvm/Support/Format.h>
+#include <sstream>
+#include <string>
+#include <vector>
 
 extern int yydebug;
 
+/// 编译一个单元，返回值即单文件模式下的进程退出码
 int
-main(int argc, char* argv[])
+compile(const char* argv0, const char* inPath, const char* outPath)
 {
-  if (argc != 3) {
-    std::cout << "Usage: " << argv[0] << " <input> <output>\n";
-    return -1;
-  }
+  // 批量模式下先丢弃上一个单元留下的全局状态，并回收它的全部对象
+  lex::g = lex::G();
+  yylineno = 1;
+  par::gTranslationUnit = nullptr;
+  par::gCurrentFunction = nullptr;
+  par::gSymtbl = asg::Symtbl();
+  par::gMgr.mRoot = nullptr;
+  par::gMgr.gc();
 
-  yyin = fopen(argv[1], "r");
-  if (!yyin) {
-    std::cerr << "Failed to open " << argv[1] << '\n';
+  // 输入文件映射到内存后交给 flex 直接扫描，不再经过 stdio 分块读取。如果
+  // 是二进制词法单元流，则直接按记录读取，根本不经过 flex 的规则
+  lex::Source source;
+  if (!source.open(inPath)) {
+    std::cerr << "Failed to open " << inPath << '\n';
     return -2;
   }
+  TokenDump dump;
+  YY_BUFFER_STATE buffer = nullptr;
+  if (dump.open(source.mData, source.mSize - 2))
+    lex::open_dump(dump);
+  else
+    buffer = yy_scan_buffer(source.mData, source.mSize);
 
   std::error_code ec;
-  llvm::StringRef outPath(argv[2]);
   llvm::raw_fd_ostream outFile(outPath, ec);
   if (ec) {
-    std::cout << "Error: unable to open output file: " << argv[2] << '\n';
+    std::cout << "Error: unable to open output file: " << outPath << '\n';
+    yy_delete_buffer(buffer);
     return -3;
   }
 
-  std::cout << "程序 " << argv[0] << std::endl;
-  std::cout << "输入 " << argv[1] << std::endl;
-  std::cout << "输出 " << argv[2] << std::endl;
+  std::cout << "程序 " << argv0 << std::endl;
+  std::cout << "输入 " << inPath << std::endl;
+  std::cout << "输出 " << outPath << std::endl;
 
   // 从源代码生成抽象语义图
   yydebug = 1; // 启用 Bison 的调试输出
-  if (auto e = yyparse())
+  auto e = yyparse();
+  yy_delete_buffer(buffer);
+  if (e)
     return e;
   par::gMgr.mRoot = par::gTranslationUnit;
-  par::gMgr.gc();
+  par::gMgr.gc().print(stderr, "语法分析后垃圾回收");
 
   // 执行类型检查
   asg::Typing typing(par::gMgr);
   typing(par::gTranslationUnit);
   typing.mTypeCache.clear();
-  par::gMgr.gc();
+  par::gMgr.gc().print(stderr, "类型检查后垃圾回收");
 
-  // 将抽象语义图转换为 JSON 并输出
+  // 遍历抽象语义图，边遍历边输出 JSON
   asg::Asg2Json asg2json;
-  llvm::json::Value json = asg2json(par::gTranslationUnit);
-  outFile << json << '\n';
+  asg2json(par::gTranslationUnit, outFile);
+  outFile << '\n';
+  return 0;
+}
+
+int
+main(int argc, char* argv[])
+{
+  if (argc == 4 && std::string(argv[1]) == "--pack")
+    return TokenDump::pack(argv[2], argv[3]);
+
+  if (argc != 3) {
+    std::cout << "Usage: " << argv[0] << " <input> <output>\n"
+              << "       " << argv[0] << " --batch <manifest>\n"
+              << "       " << argv[0] << " --pack <dump> <output>\n";
+    return -1;
+  }
+
+  if (std::string(argv[1]) != "--batch")
+    return compile(argv[0], argv[1], argv[2]);
+
+  // 批量模式：清单的每一行是一对“输入 输出”路径，空行和 # 开头的行忽略。
+  // 所有单元在同一个进程中依次编译，原子表和对象管理器的内存池跨单元复用。
+  std::ifstream manifest(argv[2]);
+  if (!manifest) {
+    std::cout << "Error: unable to open manifest: " << argv[2] << '\n';
+    return -2;
+  }
+
+  std::vector<std::pair<std::string, std::string>> units;
+  for (std::string line; std::getline(manifest, line);) {
+    std::istringstream iss(line);
+    std::string in, out;
+    if (!(iss >> in) || in[0] == '#')
+      continue;
+    if (!(iss >> out)) {
+      std::cout << "Error: missing output path for " << in << '\n';
+      return -2;
+    }
+    units.emplace_back(std::move(in), std::move(out));
+  }
+
+  using Clock = std::chrono::steady_clock;
+  int failed = 0;
+  auto begin = Clock::now();
+  for (std::size_t i = 0; i < units.size(); ++i) {
+    auto& [in, out] = units[i];
+    auto start = Clock::now();
+    auto ret = compile(argv[0], in.c_str(), out.c_str());
+    std::chrono::duration<double, std::milli> ms = Clock::now() - start;
+    if (ret != 0)
+      ++failed;
+    llvm::errs() << "[" << i + 1 << "/" << units.size() << "] " << in
+                 << " -> " << out << "：返回 " << ret << "，用时 "
+                 << llvm::format("%.3f", ms.count()) << " ms\n";
+  }
+  std::chrono::duration<double, std::milli> total = Clock::now() - begin;
+  llvm::errs() << "共 " << units.size() << " 个单元，失败 " << failed
+               << " 个，总用时 " << llvm::format("%.3f", total.count())
+               << " ms\n";
 
-  fclose(yyin);
+  return failed ? 1 : 0;
 }
@@ -6,24 +6,11 @@
 
 namespace par {
 
-Obj::Mgr gMgr;
+Obj::Mgr gMgr(Obj::Mgr::Alloc::kArena);
 asg::TranslationUnit* gTranslationUnit;
 asg::FunctionDecl* gCurrentFunction;
 
-Symtbl* Symtbl::g{ nullptr };
-
-asg::Decl*
-Symtbl::resolve(const std::string& name)
-{
-  auto cur = g;
-  while (cur) {
-    auto iter = cur->find(name);
-    if (iter != cur->end())
-      return iter->second;
-    cur = cur->mPrev;
-  }
-  return nullptr; // 标识符未定义
-}
+asg::Symtbl gSymtbl;
 
 } // namespace par
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "Symtbl.hpp"
 #include "asg.hpp"
 #include <memory>
 #include <stack>
@@ -11,26 +12,8 @@ extern Obj::Mgr gMgr;
 extern asg::TranslationUnit* gTranslationUnit;
 extern asg::FunctionDecl* gCurrentFunction;
 
-/// 符号表，语法树遍历的过程中，Symtbl::g 和 Symtbl::mPrev
-/// 隐式地构成了一个单向链表，每一个结点对应一个作用域。
-struct Symtbl : std::unordered_map<std::string, asg::Decl*>
-{
-  static Symtbl* g; ///< 当前符号表
-
-  /// 查找符号表，返回标识符 \p name 对应的声明语义结点
-  static asg::Decl* resolve(const std::string& name);
-
-  Symtbl()
-    : mPrev(g)
-  {
-    g = this;
-  }
-
-  ~Symtbl() { g = mPrev; }
-
-private:
-  Symtbl* mPrev; ///< 上一级符号表
-};
+/// 符号表，进入和退出代码块时开启和结束作用域
+extern asg::Symtbl gSymtbl;
 
 using Decls = std::vector<asg::Decl*>;
 
@@ -16,6 +16,7 @@ void yyerror (char const *);	// 该函数定义在 par.cpp 中
 
 %union {
   std::string* RawStr;
+  Atom Name;
   par::Decls* Decls;
   par::Exprs* Exprs;
 
@@ -54,7 +55,8 @@ void yyerror (char const *);	// 该函数定义在 par.cpp 中
 
 %type <TranslationUnit> translation_unit
 
-%token <RawStr> IDENTIFIER CONSTANT
+%token <Name> IDENTIFIER
+%token <RawStr> CONSTANT
 %token INT VOID
 
 %token RETURN
@@ -66,12 +68,12 @@ void yyerror (char const *);	// 该函数定义在 par.cpp 中
 // 起始符号
 start
   :	{
-      par::Symtbl::g = new par::Symtbl();
+      par::gSymtbl.enter();
     }
     translation_unit
     {
       par::gTranslationUnit = $2;
-      delete par::Symtbl::g;
+      par::gSymtbl.leave();
     }
   ;
 
@@ -133,7 +135,7 @@ declaration
           ty->texp = decl->type->texp; // 保留前面 ArrayType 的texp
         ty->spec = $1->spec, ty->qual = $1->qual;
         decl->type = ty;
-        auto varDecl = dynamic_cast<asg::VarDecl*>(decl);
+        auto varDecl = decl->dcst<asg::VarDecl>();
         if (varDecl != nullptr)
         {
           if (varDecl->init != nullptr)
@@ -170,11 +172,10 @@ declarator
   : IDENTIFIER
     {
       $$ = par::gMgr.make<asg::VarDecl>();
-      $$->name = std::move(*$1);
-      delete $1;
+      $$->name = $1;
 
       // 插入符号表
-      par::Symtbl::g->insert_or_assign($$->name, $$);
+      par::gSymtbl.declare($$->name, $$);
     }
   | declarator '[' ']' // 未知长度数组
     {
@@ -196,7 +197,7 @@ declarator
       $$->type = ty;
 
       // 插入符号表
-      par::Symtbl::g->insert_or_assign($$->name, $$);
+      par::gSymtbl.declare($$->name, $$);
     }
   | declarator '[' assignment_expression ']' // 数组定义
     {
@@ -220,7 +221,7 @@ declarator
       $$->type = ty;
 
       // 插入符号表
-      par::Symtbl::g->insert_or_assign($$->name, $$);
+      par::gSymtbl.declare($$->name, $$);
     }
   | declarator '(' ')'
     {
@@ -232,7 +233,7 @@ declarator
       $$->type = ty;
 
       // 插入符号表
-      par::Symtbl::g->insert_or_assign($$->name, $$);
+      par::gSymtbl.declare($$->name, $$);
     }
   // 函数列表的定义
   | declarator '(' parameter_list ')'
@@ -251,7 +252,7 @@ declarator
       $$ = p;
 
       // 插入符号表
-      par::Symtbl::g->insert_or_assign($$->name, $$);
+      par::gSymtbl.declare($$->name, $$);
     }
   ;
 
@@ -285,11 +286,11 @@ compound_statement
   : {$$ = par::gMgr.make<asg::CompoundStmt>();} // 代码块为空的情况
   |'{' '}' { $$ = par::gMgr.make<asg::CompoundStmt>(); }
   | '{'
-    { new par::Symtbl(); } 		// 开启新的符号表作用域
+    { par::gSymtbl.enter(); } 		// 开启新的符号表作用域
     block_item_list
     '}'
     {
-      delete par::Symtbl::g; 	// 结束符号表作用域
+      par::gSymtbl.leave(); 	// 结束符号表作用域
       $$ = $block_item_list;
     }
   ;
@@ -424,9 +425,8 @@ primary_expression
   : IDENTIFIER
     {
       // 查找符号表, 找到对应的Decl
-      auto decl = par::Symtbl::resolve(*$1);
+      auto decl = par::gSymtbl.resolve($1);
       ASSERT(decl);
-      delete $1;
       auto p = par::gMgr.make<asg::DeclRefExpr>();
       p->decl = decl;
       $$ = p;
@@ -485,8 +485,8 @@ initializer
       auto callExpr = $1->dcst<asg::CallExpr>();
       if (callExpr != nullptr)
       {
-        auto implicitCastExpr = dynamic_cast<asg::ImplicitCastExpr*>(callExpr->head);
-        auto declRefExpr = dynamic_cast<asg::DeclRefExpr*>(implicitCastExpr->sub);
+        auto implicitCastExpr = callExpr->head->dcst<asg::ImplicitCastExpr>();
+        auto declRefExpr = implicitCastExpr->sub->dcst<asg::DeclRefExpr>();
         $$ = callExpr;
       }
       else
@@ -4,19 +4,40 @@
 
 namespace asg {
 
-json::Object
-Asg2Json::operator()(TranslationUnit* tu)
+void
+Asg2Json::operator()(TranslationUnit* tu, llvm::raw_ostream& os)
 {
-  json::Object ret;
-
-  ret["kind"] = "TranslationUnitDecl";
-
-  json::Array inner;
-  for (auto&& i : tu->decls)
-    inner.push_back(self(i));
-  ret["inner"] = std::move(inner);
+  json::OStream json(os);
+  mJson = &json;
+
+  json.objectBegin();
+  json.attributeArray("inner", [&] {
+    for (auto&& i : tu->decls)
+      self(i);
+  });
+  json.attribute("kind", "TranslationUnitDecl");
+  json.objectEnd();
+
+  mJson = nullptr;
+}
 
-  return ret;
+void
+Asg2Json::write(const Attrs& attrs)
+{
+  auto& json = *mJson;
+
+  json.attribute("kind", attrs.mKind);
+  if (attrs.mName)
+    json.attribute("name", *attrs.mName);
+  if (attrs.mOpcode)
+    json.attribute("opcode", *attrs.mOpcode);
+  if (attrs.mType)
+    json.attributeObject("type",
+                         [&] { json.attribute("qualType", *attrs.mType); });
+  if (attrs.mValue)
+    json.attribute("value", *attrs.mValue);
+  if (attrs.mValueCategory)
+    json.attribute("valueCategory", *attrs.mValueCategory);
 }
 
 //==============================================================================
@@ -66,6 +87,15 @@ Asg2Json::operator()(const Type* type)
   return ret;
 }
 
+llvm::StringRef
+Asg2Json::qual_type(const Type* type)
+{
+  auto [iter, fresh] = mQualTypes.try_emplace(type);
+  if (fresh)
+    iter->second = Atom(self(type));
+  return iter->second.str();
+}
+
 std::string
 Asg2Json::operator()(TypeExpr* texp)
 {
@@ -141,89 +171,61 @@ Asg2Json::operator()(TypeExpr* texp)
   ABORT();
 }
 
+
 //==============================================================================
 // 表达式
 //==============================================================================
 
-json::Object
+void
 Asg2Json::operator()(Expr* obj)
 {
-  json::Object ret;
-
-  if (auto p = obj->dcst<IntegerLiteral>())
-    ret = std::move(self(p));
-
-  else if (auto p = obj->dcst<StringLiteral>())
-    ret = std::move(self(p));
-
-  else if (auto p = obj->dcst<DeclRefExpr>())
-    ret = std::move(self(p));
-
-  else if (auto p = obj->dcst<ParenExpr>())
-    ret = std::move(self(p));
+  mJson->objectBegin();
 
-  else if (auto p = obj->dcst<UnaryExpr>())
-    ret = std::move(self(p));
+  auto attrs =
+    visit<Attrs>(obj, [&](auto p) -> decltype(self(p)) { return self(p); });
 
-  else if (auto p = obj->dcst<BinaryExpr>())
-    ret = std::move(self(p));
-
-  else if (auto p = obj->dcst<CallExpr>())
-    ret = std::move(self(p));
-
-  else if (auto p = obj->dcst<InitListExpr>())
-    ret = std::move(self(p));
-
-  else if (auto p = obj->dcst<ImplicitInitExpr>())
-    ret = std::move(self(p));
-
-  else if (auto p = obj->dcst<ImplicitCastExpr>())
-    ret = std::move(self(p));
-
-  else
-    ABORT();
-
-  ret["type"] = json::Object({ { "qualType", self(obj->type) } });
+  attrs.mType = qual_type(obj->type);
 
   switch (obj->cate) {
     case Expr::Cate::kINVALID:
-      ret["valueCategory"] = "INVALID";
+      attrs.mValueCategory = "INVALID";
       break;
 
     case Expr::Cate::kLValue:
-      ret["valueCategory"] = "lvalue";
+      attrs.mValueCategory = "lvalue";
       break;
 
     case Expr::Cate::kRValue:
-      ret["valueCategory"] = "prvalue";
+      attrs.mValueCategory = "prvalue";
       break;
 
     default:
       ABORT();
   }
 
-  return ret;
+  write(attrs);
+  mJson->objectEnd();
 }
 
-json::Object
+Asg2Json::Attrs
 Asg2Json::operator()(IntegerLiteral* obj)
 {
-  json::Object ret;
+  Attrs ret;
   Obj::Walked guard(obj);
 
-  ret["kind"] = "IntegerLiteral";
-  ret["value"] = std::to_string(obj->val);
+  ret.mKind = "IntegerLiteral";
+  ret.mValue = std::to_string(obj->val);
 
   return ret;
 }
 
-json::Object
+Asg2Json::Attrs
 Asg2Json::operator()(StringLiteral* obj)
 {
-  json::Object ret;
+  Attrs ret;
   Obj::Walked guard(obj);
 
-  ret["kind"] = "StringLiteral";
+  ret.mKind = "StringLiteral";
 
   std::string value;
   value.push_back('"');
@@ -278,215 +280,209 @@ Asg2Json::operator()(StringLiteral* obj)
     }
   }
   value.push_back('"');
-  ret["value"] = std::move(value);
+  ret.mValue = std::move(value);
 
   return ret;
 }
 
-json::Object
+Asg2Json::Attrs
 Asg2Json::operator()(DeclRefExpr* obj)
 {
-  json::Object ret;
+  Attrs ret;
   Obj::Walked guard(obj);
 
-  ret["kind"] = "DeclRefExpr";
+  ret.mKind = "DeclRefExpr";
 
   return ret;
 }
 
-json::Object
+Asg2Json::Attrs
 Asg2Json::operator()(ParenExpr* obj)
 {
-  json::Object ret;
+  Attrs ret;
   Obj::Walked guard(obj);
 
-  ret["kind"] = "ParenExpr";
+  mJson->attributeArray("inner", [&] { self(obj->sub); });
 
-  json::Array inner;
-  inner.push_back(self(obj->sub));
-  ret["inner"] = std::move(inner);
+  ret.mKind = "ParenExpr";
 
   return ret;
 }
 
-json::Object
+Asg2Json::Attrs
 Asg2Json::operator()(UnaryExpr* obj)
 {
   assert(obj->sub);
 
-  json::Object ret;
+  Attrs ret;
   Obj::Walked guard(obj);
 
-  ret["kind"] = "UnaryOperator";
+  mJson->attributeArray("inner", [&] { self(obj->sub); });
+
+  ret.mKind = "UnaryOperator";
 
   switch (obj->op) {
     case UnaryExpr::kPos:
-      ret["opcode"] = "+";
+      ret.mOpcode = "+";
       break;
 
     case UnaryExpr::kNeg:
-      ret["opcode"] = "-";
+      ret.mOpcode = "-";
       break;
 
     case UnaryExpr::kNot:
-      ret["opcode"] = "!";
+      ret.mOpcode = "!";
       break;
 
     default:
       ABORT();
   }
 
-  json::Array inner;
-  inner.push_back(self(obj->sub));
-  ret["inner"] = std::move(inner);
-
   return ret;
 }
 
-json::Object
+Asg2Json::Attrs
 Asg2Json::operator()(BinaryExpr* obj)
 {
   assert(obj->lft && obj->rht);
 
-  json::Object ret;
+  Attrs ret;
   Obj::Walked guard(obj);
 
-  ret["kind"] = "BinaryOperator";
+  mJson->attributeArray("inner", [&] {
+    self(obj->lft);
+    self(obj->rht);
+  });
+
+  ret.mKind = "BinaryOperator";
 
   switch (obj->op) {
     case BinaryExpr::kMul:
-      ret["opcode"] = "*";
+      ret.mOpcode = "*";
       break;
 
     case BinaryExpr::kDiv:
-      ret["opcode"] = "/";
+      ret.mOpcode = "/";
       break;
 
     case BinaryExpr::kMod:
-      ret["opcode"] = "%";
+      ret.mOpcode = "%";
       break;
 
     case BinaryExpr::kAdd:
-      ret["opcode"] = "+";
+      ret.mOpcode = "+";
       break;
 
     case BinaryExpr::kSub:
-      ret["opcode"] = "-";
+      ret.mOpcode = "-";
       break;
 
     case BinaryExpr::kGt:
-      ret["opcode"] = ">";
+      ret.mOpcode = ">";
       break;
 
     case BinaryExpr::kLt:
-      ret["opcode"] = "<";
+      ret.mOpcode = "<";
       break;
 
     case BinaryExpr::kGe:
-      ret["opcode"] = ">=";
+      ret.mOpcode = ">=";
       break;
 
     case BinaryExpr::kLe:
-      ret["opcode"] = "<=";
+      ret.mOpcode = "<=";
       break;
 
     case BinaryExpr::kEq:
-      ret["opcode"] = "==";
+      ret.mOpcode = "==";
       break;
 
     case BinaryExpr::kNe:
-      ret["opcode"] = "!=";
+      ret.mOpcode = "!=";
       break;
 
     case BinaryExpr::kAnd:
-      ret["opcode"] = "&&";
+      ret.mOpcode = "&&";
       break;
 
     case BinaryExpr::kOr:
-      ret["opcode"] = "||";
+      ret.mOpcode = "||";
       break;
 
     case BinaryExpr::kAssign:
-      ret["opcode"] = "=";
+      ret.mOpcode = "=";
       break;
 
     case BinaryExpr::kComma:
-      ret["opcode"] = ",";
+      ret.mOpcode = ",";
       break;
 
     case BinaryExpr::kIndex:
-      ret["kind"] = "ArraySubscriptExpr";
+      ret.mKind = "ArraySubscriptExpr";
       break;
 
     default:
       ABORT();
   }
 
-  json::Array inner;
-  inner.push_back(self(obj->lft));
-  inner.push_back(self(obj->rht));
-  ret["inner"] = std::move(inner);
-
   return ret;
 }
 
-json::Object
+Asg2Json::Attrs
 Asg2Json::operator()(CallExpr* obj)
 {
   assert(obj->head);
 
-  json::Object ret;
+  Attrs ret;
   Obj::Walked guard(obj);
 
-  ret["kind"] = "CallExpr";
+  mJson->attributeArray("inner", [&] {
+    self(obj->head);
+    for (auto&& i : obj->args)
+      self(i);
+  });
 
-  json::Array inner;
-  inner.push_back(self(obj->head));
-  for (auto&& i : obj->args)
-    inner.push_back(self(i));
-  ret["inner"] = std::move(inner);
+  ret.mKind = "CallExpr";
 
   return ret;
 }
 
-json::Object
+Asg2Json::Attrs
 Asg2Json::operator()(InitListExpr* obj)
 {
-  json::Object ret;
+  Attrs ret;
   Obj::Walked guard(obj);
 
-  ret["kind"] = "InitListExpr";
+  mJson->attributeArray("inner", [&] {
+    for (auto&& i : obj->list)
+      self(i);
+  });
 
-  json::Array inner;
-  for (auto&& i : obj->list)
-    inner.push_back(self(i));
-  ret["inner"] = std::move(inner);
+  ret.mKind = "InitListExpr";
 
   return ret;
 }
 
-json::Object
+Asg2Json::Attrs
 Asg2Json::operator()(ImplicitInitExpr* obj)
 {
-  json::Object ret;
+  Attrs ret;
   Obj::Walked guard(obj);
 
-  ret["kind"] = "InitListExpr";
+  ret.mKind = "InitListExpr";
 
   return ret;
 }
 
-json::Object
+Asg2Json::Attrs
 Asg2Json::operator()(ImplicitCastExpr* obj)
 {
-  json::Object ret;
+  Attrs ret;
   Obj::Walked guard(obj);
 
-  ret["kind"] = "ImplicitCastExpr";
+  mJson->attributeArray("inner", [&] { self(obj->sub); });
 
-  json::Array inner;
-  inner.push_back(self(obj->sub));
-  ret["inner"] = std::move(inner);
+  ret.mKind = "ImplicitCastExpr";
 
   return ret;
 }
@@ -495,170 +491,147 @@ Asg2Json::operator()(ImplicitCastExpr* obj)
 // 语句
 //==============================================================================
 
-json::Object
+void
 Asg2Json::operator()(Stmt* obj)
 {
-  if (auto p = obj->dcst<DeclStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<ExprStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<CompoundStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<IfStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<WhileStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<DoStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<BreakStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<ContinueStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<ReturnStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<NullStmt>()) {
-    json::Object ret;
-    ret["kind"] = "NullStmt";
-    return ret;
+  // 表达式语句直接输出为其中的表达式
+  if (auto p = obj->dcst<ExprStmt>()) {
+    assert(p->expr);
+    return self(p->expr);
   }
 
-  ABORT();
+  mJson->objectBegin();
+  write(
+    visit<Attrs>(obj, [&](auto p) -> decltype(self(p)) { return self(p); }));
+  mJson->objectEnd();
+}
+
+Asg2Json::Attrs
+Asg2Json::operator()(NullStmt* obj)
+{
+  Attrs ret;
+  ret.mKind = "NullStmt";
+  return ret;
 }
 
-json::Object
+Asg2Json::Attrs
 Asg2Json::operator()(DeclStmt* obj)
 {
-  json::Object ret;
+  Attrs ret;
   Obj::Walked guard(obj);
 
-  ret["kind"] = "DeclStmt";
+  mJson->attributeArray("inner", [&] {
+    for (auto&& i : obj->decls)
+      self(i);
+  });
 
-  json::Array inner;
-  for (auto&& i : obj->decls)
-    inner.push_back(self(i));
-  ret["inner"] = std::move(inner);
+  ret.mKind = "DeclStmt";
 
   return ret;
 }
 
-json::Object
-Asg2Json::operator()(ExprStmt* obj)
-{
-  assert(obj->expr);
-  return self(obj->expr);
-}
-
-json::Object
+Asg2Json::Attrs
 Asg2Json::operator()(CompoundStmt* obj)
 {
-  json::Object ret;
+  Attrs ret;
   Obj::Walked guard(obj);
 
-  ret["kind"] = "CompoundStmt";
+  mJson->attributeArray("inner", [&] {
+    for (auto&& i : obj->subs)
+      self(i);
+  });
 
-  json::Array inner;
-  for (auto&& i : obj->subs)
-    inner.push_back(self(i));
-  ret["inner"] = std::move(inner);
+  ret.mKind = "CompoundStmt";
 
   return ret;
 }
 
-json::Object
+Asg2Json::Attrs
 Asg2Json::operator()(IfStmt* obj)
 {
   assert(obj->cond && obj->then);
 
-  json::Object ret;
+  Attrs ret;
   Obj::Walked guard(obj);
 
-  ret["kind"] = "IfStmt";
+  mJson->attributeArray("inner", [&] {
+    self(obj->cond);
+    self(obj->then);
+    if (obj->else_)
+      self(obj->else_);
+  });
 
-  json::Array inner;
-  inner.push_back(self(obj->cond));
-  inner.push_back(self(obj->then));
-  if (obj->else_)
-    inner.push_back(self(obj->else_));
-  ret["inner"] = std::move(inner);
+  ret.mKind = "IfStmt";
 
   return ret;
 }
 
-json::Object
+Asg2Json::Attrs
 Asg2Json::operator()(WhileStmt* obj)
 {
-  json::Object ret;
+  Attrs ret;
   Obj::Walked guard(obj);
 
-  ret["kind"] = "WhileStmt";
+  mJson->attributeArray("inner", [&] {
+    self(obj->cond);
+    self(obj->body);
+  });
 
-  json::Array inner;
-  inner.push_back(self(obj->cond));
-  inner.push_back(self(obj->body));
-  ret["inner"] = std::move(inner);
+  ret.mKind = "WhileStmt";
 
   return ret;
 }
 
-json::Object
+Asg2Json::Attrs
 Asg2Json::operator()(DoStmt* obj)
 {
-  json::Object ret;
+  Attrs ret;
   Obj::Walked guard(obj);
 
-  ret["kind"] = "DoStmt";
+  mJson->attributeArray("inner", [&] {
+    self(obj->body);
+    self(obj->cond);
+  });
 
-  json::Array inner;
-  inner.push_back(self(obj->body));
-  inner.push_back(self(obj->cond));
-  ret["inner"] = std::move(inner);
+  ret.mKind = "DoStmt";
 
   return ret;
 }
 
-json::Object
+Asg2Json::Attrs
 Asg2Json::operator()(BreakStmt* obj)
 {
-  json::Object ret;
+  Attrs ret;
   Obj::Walked guard(obj);
 
-  ret["kind"] = "BreakStmt";
+  ret.mKind = "BreakStmt";
 
   return ret;
 }
 
-json::Object
+Asg2Json::Attrs
 Asg2Json::operator()(ContinueStmt* obj)
 {
-  json::Object ret;
+  Attrs ret;
   Obj::Walked guard(obj);
 
-  ret["kind"] = "ContinueStmt";
+  ret.mKind = "ContinueStmt";
 
   return ret;
 }
 
-json::Object
+Asg2Json::Attrs
 Asg2Json::operator()(ReturnStmt* obj)
 {
-  json::Object ret;
+  Attrs ret;
   Obj::Walked guard(obj);
 
-  ret["kind"] = "ReturnStmt";
+  mJson->attributeArray("inner", [&] {
+    if (obj->expr)
+      self(obj->expr);
+  });
 
-  json::Array inner;
-  if (obj->expr)
-    inner.push_back(self(obj->expr));
-  ret["inner"] = std::move(inner);
+  ret.mKind = "ReturnStmt";
 
   return ret;
 }
@@ -667,67 +640,59 @@ Asg2Json::operator()(ReturnStmt* obj)
 // 声明
 //==============================================================================
 
-json::Object
+void
 Asg2Json::operator()(Decl* obj)
 {
-  json::Object ret;
-
-  if (auto p = obj->dcst<VarDecl>())
-    ret = std::move(self(p));
-
-  else if (auto p = obj->dcst<FunctionDecl>())
-    ret = std::move(self(p));
-
-  else
-    ABORT();
+  mJson->objectBegin();
 
-  ret["type"] = json::Object({ { "qualType", self(obj->type) } });
+  auto attrs =
+    visit<Attrs>(obj, [&](auto p) -> decltype(self(p)) { return self(p); });
+  attrs.mType = qual_type(obj->type);
 
-  return ret;
+  write(attrs);
+  mJson->objectEnd();
 }
 
-json::Object
+Asg2Json::Attrs
 Asg2Json::operator()(VarDecl* obj)
 {
-  json::Object ret;
+  Attrs ret;
   Obj::Walked guard(obj);
 
-  ret["kind"] = "VarDecl";
-
-  ret["name"] = obj->name;
+  mJson->attributeArray("inner", [&] {
+    if (obj->init)
+      self(obj->init);
+  });
 
-  json::Array inner;
-  if (obj->init)
-    inner.push_back(self(obj->init));
-  ret["inner"] = std::move(inner);
+  ret.mKind = "VarDecl";
+  ret.mName = llvm::StringRef(obj->name);
 
   return ret;
 }
 
-json::Object
+Asg2Json::Attrs
 Asg2Json::operator()(FunctionDecl* obj)
 {
-  json::Object ret;
+  Attrs ret;
   Obj::Walked guard(obj);
 
-  ret["kind"] = "FunctionDecl";
-
-  ret["name"] = obj->name;
+  mJson->attributeArray("inner", [&] {
+    for (auto&& i : obj->params) {
+      Attrs param;
+      param.mKind = "ParmVarDecl";
+      param.mName = llvm::StringRef(i->name);
+      param.mType = qual_type(i->type);
 
-  json::Array inner;
-  for (auto&& i : obj->params) {
-    json::Object pobj;
-    pobj["kind"] = "ParmVarDecl";
-    pobj["name"] = i->name;
-    pobj["type"] = json::Object({ { "qualType", self(i->type) } });
-
-    inner.push_back(std::move(pobj));
-  }
+      mJson->object([&] { write(param); });
+    }
 
-  if (obj->body)
-    inner.push_back(self(obj->body));
+    // 经由 Stmt* 的重载才会写出对象的括号
+    if (obj->body)
+      self(static_cast<Stmt*>(obj->body));
+  });
 
-  ret["inner"] = std::move(inner);
+  ret.mKind = "FunctionDecl";
+  ret.mName = llvm::StringRef(obj->name);
 
   return ret;
 }
@@ -1,16 +1,42 @@
 #include "asg.hpp"
 #include <llvm/Support/JSON.h>
+#include <optional>
+#include <unordered_map>
 
 namespace asg {
 
 namespace json = llvm::json;
 
+/**
+ * @brief 以流的方式把抽象语义图输出为 JSON
+ *
+ * 遍历的同时通过 json::OStream 直接写出结点，不构造 json::Value 树，内存
+ * 占用只与嵌套深度有关。json::Object 输出时按键的字典序排列，这里的每个
+ * 对象也按同样的次序写出各个键，因此输出与先建树再打印的结果逐字节相同。
+ * 由于 "inner" 是字典序最小的键，子结点总是先于父结点的其它属性写出。
+ */
 class Asg2Json
 {
 public:
-  json::Object operator()(TranslationUnit* tu);
+  void operator()(TranslationUnit* tu, llvm::raw_ostream& os);
 
 private:
+  json::OStream* mJson{ nullptr };
+
+  /// 一个对象中除 "inner" 以外的键，成员按键的字典序排列
+  struct Attrs
+  {
+    llvm::StringRef mKind;
+    std::optional<llvm::StringRef> mName;
+    std::optional<llvm::StringRef> mOpcode;
+    std::optional<llvm::StringRef> mType; ///< 写作 {"qualType": ...}
+    std::optional<std::string> mValue;
+    std::optional<llvm::StringRef> mValueCategory;
+  };
+
+  /// 写出 \p attrs 中的键，调用前应已写完 "inner"
+  void write(const Attrs& attrs);
+
   //============================================================================
   // 类型
   //============================================================================
@@ -19,65 +45,70 @@ private:
 
   std::string operator()(TypeExpr* texp);
 
+  /// 类型的字符串表示，按类型结点缓存并驻留为原子，因而可以不复制地放进 JSON
+  llvm::StringRef qual_type(const Type* type);
+
+  std::unordered_map<const Type*, Atom> mQualTypes;
+
   //============================================================================
   // 表达式
   //============================================================================
 
-  json::Object operator()(Expr* obj);
+  void operator()(Expr* obj);
 
-  json::Object operator()(IntegerLiteral* obj);
+  Attrs operator()(IntegerLiteral* obj);
 
-  json::Object operator()(StringLiteral* obj);
+  Attrs operator()(StringLiteral* obj);
 
-  json::Object operator()(ParenExpr* obj);
+  Attrs operator()(ParenExpr* obj);
 
-  json::Object operator()(DeclRefExpr* obj);
+  Attrs operator()(DeclRefExpr* obj);
 
-  json::Object operator()(UnaryExpr* obj);
+  Attrs operator()(UnaryExpr* obj);
 
-  json::Object operator()(BinaryExpr* obj);
+  Attrs operator()(BinaryExpr* obj);
 
-  json::Object operator()(CallExpr* obj);
+  Attrs operator()(CallExpr* obj);
 
-  json::Object operator()(InitListExpr* obj);
+  Attrs operator()(InitListExpr* obj);
 
-  json::Object operator()(ImplicitInitExpr* obj);
+  Attrs operator()(ImplicitInitExpr* obj);
 
-  json::Object operator()(ImplicitCastExpr* obj);
+  Attrs operator()(ImplicitCastExpr* obj);
 
   //============================================================================
   // 语句
   //============================================================================
 
-  json::Object operator()(Stmt* obj);
+  void operator()(Stmt* obj);
 
-  json::Object operator()(DeclStmt* obj);
+  Attrs operator()(NullStmt* obj);
 
-  json::Object operator()(ExprStmt* obj);
+  Attrs operator()(DeclStmt* obj);
 
-  json::Object operator()(CompoundStmt* obj);
+  Attrs operator()(CompoundStmt* obj);
 
-  json::Object operator()(IfStmt* obj);
+  Attrs operator()(IfStmt* obj);
 
-  json::Object operator()(WhileStmt* obj);
+  Attrs operator()(WhileStmt* obj);
 
-  json::Object operator()(DoStmt* obj);
+  Attrs operator()(DoStmt* obj);
 
-  json::Object operator()(BreakStmt* obj);
+  Attrs operator()(BreakStmt* obj);
 
-  json::Object operator()(ContinueStmt* obj);
+  Attrs operator()(ContinueStmt* obj);
 
-  json::Object operator()(ReturnStmt* obj);
+  Attrs operator()(ReturnStmt* obj);
 
   //============================================================================
   // 声明
   //============================================================================
 
-  json::Object operator()(Decl* obj);
+  void operator()(Decl* obj);
 
-  json::Object operator()(VarDecl* obj);
+  Attrs operator()(VarDecl* obj);
 
-  json::Object operator()(FunctionDecl* obj);
+  Attrs operator()(FunctionDecl* obj);
 };
 
 } // namespace asg
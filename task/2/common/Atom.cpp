@@ -0,0 +1,75 @@
+#include "Atom.hpp"
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+/// 原子表，字符内容从大块中顺序切分，因此 string_view 永不失效
+struct Table
+{
+  static constexpr std::size_t kBlockSize = std::size_t(64) << 10;
+
+  std::unordered_map<std::string_view, std::uint32_t> mIds;
+  std::vector<std::string_view> mStrs;
+  std::vector<std::unique_ptr<char[]>> mBlocks;
+  char* mTop{ nullptr };
+  char* mEnd{ nullptr };
+
+  Table()
+  {
+    mIds.emplace(std::string_view(), 0);
+    mStrs.emplace_back();
+  }
+
+  std::string_view store(std::string_view str)
+  {
+    if (std::size_t(mEnd - mTop) < str.size()) {
+      auto size = std::max(kBlockSize, str.size());
+      mBlocks.emplace_back(new char[size]);
+      mTop = mBlocks.back().get();
+      mEnd = mTop + size;
+    }
+    auto data = mTop;
+    std::memcpy(data, str.data(), str.size());
+    mTop += str.size();
+    return { data, str.size() };
+  }
+};
+
+Table&
+table()
+{
+  static Table t;
+  return t;
+}
+
+} // namespace
+
+Atom::Atom(std::string_view str)
+{
+  auto& t = table();
+  auto iter = t.mIds.find(str);
+  if (iter != t.mIds.end()) {
+    mId = iter->second;
+    return;
+  }
+  mId = t.mStrs.size();
+  auto stored = t.store(str);
+  t.mStrs.push_back(stored);
+  t.mIds.emplace(stored, mId);
+}
+
+std::string_view
+Atom::str() const
+{
+  return table().mStrs[mId];
+}
+
+std::size_t
+Atom::count()
+{
+  return table().mStrs.size();
+}
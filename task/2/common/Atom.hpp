@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief 原子，即驻留（intern）后的字符串
+ *
+ * 全局的原子表给每个不同的字符串分配一个编号，并且只保存一份内容，此后原子
+ * 只是一个 32 位整数：比较和哈希都是整数运算，str() 返回的 string_view 在
+ * 整个程序运行期间都有效。编号 0 固定对应空字符串。
+ *
+ * 与内置整数一样，默认构造的原子不做初始化（从而可以放进 bison 的
+ * %union），需要空原子时请写 `Atom{}`。
+ */
+class Atom
+{
+public:
+  Atom() = default;
+
+  /// 驻留字符串 \p str ，相同内容的字符串得到相同的原子
+  Atom(std::string_view str);
+
+  Atom(const std::string& str)
+    : Atom(std::string_view(str))
+  {
+  }
+
+  Atom(const char* str)
+    : Atom(std::string_view(str))
+  {
+  }
+
+  std::uint32_t id() const { return mId; }
+
+  bool empty() const { return mId == 0; }
+
+  std::string_view str() const;
+
+  operator std::string_view() const { return str(); }
+
+  bool operator==(Atom other) const { return mId == other.mId; }
+  bool operator!=(Atom other) const { return mId != other.mId; }
+
+  /// 已驻留的字符串数，即当前最大编号加一
+  static std::size_t count();
+
+private:
+  std::uint32_t mId;
+};
+
+template<>
+struct std::hash<Atom>
+{
+  std::size_t operator()(Atom atom) const noexcept { return atom.id(); }
+};
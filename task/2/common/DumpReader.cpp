@@ -0,0 +1,100 @@
+#include "DumpReader.hpp"
+#include <charconv>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+/// [pos, end) 中第一个换行符的位置，没有时返回 end
+const char*
+find_newline(const char* pos, const char* end)
+{
+#ifdef __SSE2__
+  auto nl = _mm_set1_epi8('\n');
+  for (; end - pos >= 16; pos += 16) {
+    auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+    if (auto mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, nl)))
+      return pos + __builtin_ctz(mask);
+  }
+#endif
+  auto found = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+  return found ? found : end;
+}
+
+bool
+parse_number(std::string_view str, std::uint32_t& value)
+{
+  auto end = str.data() + str.size();
+  auto [ptr, ec] = std::from_chars(str.data(), end, value);
+  return ec == std::errc() && ptr == end;
+}
+
+} // namespace
+
+bool
+DumpReader::next(Token& tok)
+{
+  while (mPos != mEnd) {
+    auto end = find_newline(mPos, mEnd);
+    std::string_view line(mPos, end - mPos);
+    mPos = end == mEnd ? end : end + 1;
+    ++mLineNo;
+
+    if (line.empty() || line[0] == '#' || line == "\r")
+      continue;
+    if (parse(line, tok))
+      return true;
+    mError = mLineNo;
+    return false;
+  }
+  return false;
+}
+
+bool
+DumpReader::parse(std::string_view line, Token& tok)
+{
+  // 一行的格式形如
+  //
+  //     int 'int'	 [StartOfLine]	Loc=<a.c:1:1>
+  while (!line.empty() && (line.back() == '\n' || line.back() == '\r'))
+    line.remove_suffix(1);
+
+  // 种类名后紧跟一个空格和文本的左引号
+  auto kindEnd = line.find(' ');
+  if (kindEnd == std::string_view::npos || kindEnd + 1 == line.size() ||
+      line[kindEnd + 1] != '\'')
+    return false;
+
+  // 文本中可能含有引号和制表符，因此从行尾往回找位置段，再以位置段之前的
+  // 最后一个引号作为文本的结束
+  auto locStart = line.rfind("Loc=<");
+  auto locEnd = line.rfind('>');
+  if (locStart == std::string_view::npos || locEnd == std::string_view::npos ||
+      locEnd < locStart + 5)
+    return false;
+  auto textEnd = line.rfind('\'', locStart);
+  if (textEnd == std::string_view::npos || textEnd <= kindEnd + 1)
+    return false;
+
+  // 文件名中也可能有冒号，行号和列号取最后两段
+  auto loc = line.substr(locStart + 5, locEnd - locStart - 5);
+  auto colStart = loc.rfind(':');
+  if (colStart == std::string_view::npos || colStart == 0)
+    return false;
+  auto rowStart = loc.rfind(':', colStart - 1);
+  if (rowStart == std::string_view::npos)
+    return false;
+
+  tok.mKind = line.substr(0, kindEnd);
+  tok.mText = line.substr(kindEnd + 2, textEnd - kindEnd - 2);
+  auto file = loc.substr(0, rowStart);
+  if (file != mFile.str())
+    mFile = Atom(file);
+  tok.mFile = mFile;
+  return parse_number(loc.substr(rowStart + 1, colStart - rowStart - 1),
+                      tok.mLine) &&
+         parse_number(loc.substr(colStart + 1), tok.mColumn);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Atom.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * @brief clang -dump-tokens 文本输出的读取器
+ *
+ * 直接在调用者提供的内存（通常是映射进来的整个文件）上切分行、解析字段，
+ * 词法单元的种类名和文本都是指向这块内存的 string_view，整个过程不分配
+ * 内存。文件名驻留为原子，并且只在与上一行不同时才查一次原子表。换行符的
+ * 查找在支持 SSE2 时每次比较 16 个字节。
+ */
+class DumpReader
+{
+public:
+  struct Token
+  {
+    std::string_view mKind; ///< 种类名，例如 identifier
+    std::string_view mText; ///< 引号之间的文本
+    Atom mFile;             ///< 文件名
+    std::uint32_t mLine;    ///< 行号
+    std::uint32_t mColumn;  ///< 列号
+  };
+
+  DumpReader() = default;
+
+  DumpReader(const char* data, std::size_t size)
+    : mPos(data)
+    , mEnd(data + size)
+  {
+  }
+
+  /// 读取下一个词法单元，跳过空行和 # 开头的行。到达末尾或遇到无法解析的
+  /// 行时返回 false，后者可以由 error() 区分。
+  bool next(Token& tok);
+
+  /// 解析一行，行尾的换行符可有可无
+  bool parse(std::string_view line, Token& tok);
+
+  /// 无法解析的行的行号，没有出错时为 0
+  std::size_t error() const { return mError; }
+
+private:
+  const char* mPos{ nullptr };
+  const char* mEnd{ nullptr };
+  std::size_t mLineNo{ 0 };
+  std::size_t mError{ 0 };
+  Atom mFile{}; ///< 上一行的文件名
+};
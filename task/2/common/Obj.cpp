@@ -1,26 +1,104 @@
 #include "Obj.hpp"
+#include <chrono>
 
-void
+namespace {
+
+double
+elapsed_ms(std::chrono::steady_clock::time_point since)
+{
+  return std::chrono::duration<double, std::milli>(
+           std::chrono::steady_clock::now() - since)
+    .count();
+}
+
+} // namespace
+
+Obj::Mgr* Obj::Mgr::sMarking{ nullptr };
+
+Obj::Mgr::GcStats
 Obj::Mgr::gc()
 {
-  // 标记可达对象
-  gc_mark_dfs(this);
+  GcStats stats;
+
+  // 标记可达对象。标记使用显式栈而不是递归，深层嵌套的表达式不会耗尽调用
+  // 栈；栈满时对象只打标记不入栈，待栈空后重新扫描世界环，从已标记对象出
+  // 发补上遗漏的引用，直到某一轮不再溢出。
+  auto start = std::chrono::steady_clock::now();
+  sMarking = this;
+  if (mMarkStack.capacity() < mMarkStackLimit)
+    mMarkStack.reserve(mMarkStackLimit);
+  mMarkOverflow = false;
+  gc_mark_push(this);
+  gc_mark_drain();
+  while (mMarkOverflow) {
+    mMarkOverflow = false;
+    ++stats.mRescans;
+    for (auto obj = gc_next(this); obj != this; obj = gc_next(obj)) {
+      if (gc_marked(obj)) {
+        obj->__mark__(&gc_mark_push);
+        gc_mark_drain();
+      }
+    }
+  }
+  sMarking = nullptr;
+  stats.mMarkMs = elapsed_ms(start);
 
-  // 清扫不可达对象
+  // 清扫不可达对象，摘链时保留 here 自身的标记位
+  start = std::chrono::steady_clock::now();
   Obj* here = this;
   while (true) {
     gc_unmark(here);
-    auto next = here->__next__;
+    auto next = gc_next(here);
     if (next == this)
       break;
 
-    if (!gc_marked(next))
-      here->__next__ = next->__next__, delete next;
-    else
-      here = next;
+    if (!gc_marked(next)) {
+      reinterpret_cast<uintptr_t&>(here->__next__) =
+        reinterpret_cast<uintptr_t>(gc_next(next)) |
+        (reinterpret_cast<uintptr_t>(here->__next__) & uintptr_t(0b111));
+      gc_free(next);
+      ++stats.mFreed;
+    } else
+      here = next, ++stats.mLive;
+  }
+  stats.mSweepMs = elapsed_ms(start);
+
+  return stats;
+}
+
+void
+Obj::Mgr::GcStats::print(std::FILE* out, const char* tag) const
+{
+  fprintf(out,
+          "%s：存活 %zu 个对象，释放 %zu 个，标记 %.3f ms，清扫 %.3f ms，"
+          "标记栈溢出重扫 %zu 次\n",
+          tag,
+          mLive,
+          mFreed,
+          mMarkMs,
+          mSweepMs,
+          mRescans);
+}
+
+Obj::Mgr::~Mgr()
+{
+  for (auto obj = gc_next(this); obj != this;) {
+    auto next = gc_next(obj);
+    gc_free(obj);
+    obj = next;
   }
 }
 
+void
+Obj::Mgr::gc_free(Obj* obj)
+{
+  if (reinterpret_cast<uintptr_t>(obj->__next__) & uintptr_t(0b100)) {
+    obj->~Obj();
+    mArena->free(obj);
+  } else
+    delete obj;
+}
+
 void
 Obj::Mgr::__mark__(Mark mark)
 {
@@ -28,9 +106,70 @@ Obj::Mgr::__mark__(Mark mark)
 }
 
 void
-Obj::Mgr::gc_mark_dfs(Obj* obj)
+Obj::Mgr::gc_mark_push(Obj* obj)
 {
   if (obj == nullptr || gc_marked(obj))
     return;
-  gc_mark(obj), obj->__mark__(&gc_mark_dfs);
+  gc_mark(obj);
+
+  auto& stack = sMarking->mMarkStack;
+  if (stack.size() < sMarking->mMarkStackLimit)
+    stack.push_back(obj);
+  else
+    sMarking->mMarkOverflow = true;
+}
+
+void
+Obj::Mgr::gc_mark_drain()
+{
+  while (!mMarkStack.empty()) {
+    auto obj = mMarkStack.back();
+    mMarkStack.pop_back();
+
+    // 扫描当前对象的同时预取下一个要扫描的对象
+#if defined(__GNUC__)
+    if (!mMarkStack.empty())
+      __builtin_prefetch(mMarkStack.back());
+#endif
+
+    obj->__mark__(&gc_mark_push);
+  }
+}
+
+//==============================================================================
+// 竞技场
+//==============================================================================
+
+Obj::Arena::~Arena()
+{
+  while (mSlabs) {
+    auto next = mSlabs->mNext;
+    std::free(mSlabs);
+    mSlabs = next;
+  }
+}
+
+void
+Obj::Arena::free(void* cell)
+{
+  auto slab = reinterpret_cast<Slab*>(reinterpret_cast<uintptr_t>(cell) &
+                                      ~uintptr_t(kSlabSize - 1));
+  *static_cast<void**>(cell) = mFree[slab->mClass];
+  mFree[slab->mClass] = cell;
+}
+
+void
+Obj::Arena::refill(std::size_t cls)
+{
+  auto slab = static_cast<Slab*>(std::aligned_alloc(kSlabSize, kSlabSize));
+  if (slab == nullptr)
+    throw std::bad_alloc();
+  slab->mNext = mSlabs, slab->mClass = cls;
+  mSlabs = slab;
+  ++mSlabCount;
+
+  auto cellSize = (cls + 1) * kGrain;
+  auto begin = reinterpret_cast<char*>(slab) + kHeadSize;
+  mTop[cls] = begin;
+  mEnd[cls] = begin + (kSlabSize - kHeadSize) / cellSize * cellSize;
 }
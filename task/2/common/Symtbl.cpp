@@ -0,0 +1,44 @@
+#include "Symtbl.hpp"
+
+namespace asg {
+
+void
+Symtbl::leave()
+{
+  ASSERT(!mMarks.empty());
+  auto mark = mMarks.back();
+  mMarks.pop_back();
+
+  for (auto i = mLog.size(); i > mark; --i)
+    mStacks[mLog[i - 1]].pop_back();
+  mLog.resize(mark);
+}
+
+void
+Symtbl::declare(Atom name, Decl* decl)
+{
+  ASSERT(!mMarks.empty());
+
+  if (mStacks.size() <= name.id())
+    mStacks.resize(name.id() + 1);
+
+  auto& stack = mStacks[name.id()];
+  auto depth = mMarks.size();
+  if (!stack.empty() && stack.back().mDepth == depth) {
+    stack.back().mDecl = decl;
+    return;
+  }
+  stack.push_back({ decl, depth });
+  mLog.push_back(name.id());
+}
+
+Decl*
+Symtbl::resolve(Atom name) const
+{
+  if (mStacks.size() <= name.id())
+    return nullptr;
+  auto& stack = mStacks[name.id()];
+  return stack.empty() ? nullptr : stack.back().mDecl;
+}
+
+} // namespace asg
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "asg.hpp"
+
+namespace asg {
+
+/**
+ * @brief 作用域符号表
+ *
+ * 所有作用域共用一张扁平的表，以标识符的原子编号为下标，每一项是该标识符
+ * 的遮蔽栈，栈顶就是当前可见的声明，因此查找只需一次数组访问，与作用域的
+ * 嵌套深度无关。每个作用域把自己压过栈的编号依次记在撤销日志中，退出作用
+ * 域时逐个弹出，代价只与该作用域中的声明数成正比。
+ */
+class Symtbl
+{
+public:
+  /// 作用域守卫，构造时进入新的作用域，析构时退出
+  class Scope
+  {
+  public:
+    explicit Scope(Symtbl& symtbl)
+      : mSymtbl(symtbl)
+    {
+      symtbl.enter();
+    }
+
+    ~Scope() { mSymtbl.leave(); }
+
+    Scope(const Scope&) = delete;
+    void operator=(const Scope&) = delete;
+
+  private:
+    Symtbl& mSymtbl;
+  };
+
+  /// 进入新的作用域
+  void enter() { mMarks.push_back(mLog.size()); }
+
+  /// 退出当前作用域，撤销其中的所有声明
+  void leave();
+
+  /// 在当前作用域中声明 \p name ，同一作用域内的重复声明会取代旧声明
+  void declare(Atom name, Decl* decl);
+
+  /// 查找标识符 \p name 当前可见的声明，未定义时返回 nullptr
+  Decl* resolve(Atom name) const;
+
+private:
+  struct Shadow
+  {
+    Decl* mDecl;
+    std::size_t mDepth; ///< 声明所在作用域的深度
+  };
+
+  std::vector<std::vector<Shadow>> mStacks; ///< 以原子编号为下标的遮蔽栈
+  std::vector<std::uint32_t> mLog; ///< 撤销日志，记录压过栈的原子编号
+  std::vector<std::size_t> mMarks; ///< 每个作用域开始时撤销日志的长度
+};
+
+} // namespace asg
@@ -0,0 +1,136 @@
+#include "TokenDump.hpp"
+#include "DumpReader.hpp"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+/// 字符串表，相同的字符串只保存一次
+struct Strings
+{
+  std::unordered_map<std::string_view, std::uint32_t> mOffsets;
+  std::string mData;
+
+  std::uint32_t intern(std::string_view str)
+  {
+    auto [iter, inserted] = mOffsets.try_emplace(str, mData.size());
+    if (!inserted)
+      return iter->second;
+    std::uint32_t len = str.size();
+    mData.append(reinterpret_cast<const char*>(&len), 4);
+    mData.append(str);
+    mData.append(4 - str.size() % 4, '\0');
+    return iter->second;
+  }
+};
+
+} // namespace
+
+std::size_t
+TokenDump::convert(std::string_view text, std::string& out)
+{
+  Strings strings;
+  std::unordered_map<std::string_view, std::uint32_t> kindIds;
+  std::vector<std::uint32_t> kinds;
+  std::vector<Record> records;
+
+  DumpReader reader(text.data(), text.size());
+  DumpReader::Token tok;
+  while (reader.next(tok)) {
+    auto [iter, inserted] = kindIds.try_emplace(tok.mKind, kinds.size());
+    if (inserted)
+      kinds.push_back(strings.intern(tok.mKind));
+    records.push_back({ iter->second,
+                        strings.intern(tok.mText),
+                        strings.intern(tok.mFile),
+                        tok.mLine,
+                        tok.mColumn });
+  }
+  if (reader.error())
+    return reader.error();
+
+  Header header;
+  std::memcpy(header.mMagic, kMagic, sizeof(kMagic));
+  header.mKinds = kinds.size();
+  header.mCount = records.size();
+  header.mStrings = strings.mData.size();
+
+  out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.append(reinterpret_cast<const char*>(kinds.data()),
+             kinds.size() * sizeof(std::uint32_t));
+  out.append(reinterpret_cast<const char*>(records.data()),
+             records.size() * sizeof(Record));
+  out.append(strings.mData);
+  return 0;
+}
+
+int
+TokenDump::pack(const char* inPath, const char* outPath)
+{
+  std::ifstream inFile(inPath, std::ios::binary);
+  if (!inFile) {
+    std::cout << "Error: unable to open input file: " << inPath << '\n';
+    return -2;
+  }
+  std::ostringstream text;
+  text << inFile.rdbuf();
+
+  std::string out;
+  if (auto lineNo = convert(text.str(), out)) {
+    std::cout << "Error: " << inPath << ':' << lineNo
+              << ": unable to parse token\n";
+    return -4;
+  }
+
+  std::ofstream outFile(outPath, std::ios::binary);
+  if (!outFile.write(out.data(), out.size())) {
+    std::cout << "Error: unable to open output file: " << outPath << '\n';
+    return -3;
+  }
+  return 0;
+}
+
+bool
+TokenDump::open(const char* data, std::size_t size)
+{
+  if (size < sizeof(Header) || reinterpret_cast<std::uintptr_t>(data) % 4 ||
+      std::memcmp(data, kMagic, sizeof(kMagic)))
+    return false;
+
+  auto header = reinterpret_cast<const Header*>(data);
+  auto expected = sizeof(Header) + std::uint64_t(header->mKinds) * 4 +
+                  std::uint64_t(header->mCount) * sizeof(Record) +
+                  header->mStrings;
+  if (expected != size)
+    return false;
+
+  mHeader = header;
+  mKinds = reinterpret_cast<const std::uint32_t*>(header + 1);
+  mRecords = reinterpret_cast<const Record*>(mKinds + header->mKinds);
+  mStrings = reinterpret_cast<const char*>(mRecords + header->mCount);
+
+  // 所有偏移都在这里检查一遍，此后的访问不再做边界检查
+  for (std::uint32_t i = 0; i < header->mKinds; ++i)
+    if (!valid(mKinds[i]))
+      return false;
+  for (std::uint32_t i = 0; i < header->mCount; ++i) {
+    auto& rec = mRecords[i];
+    if (rec.mKind >= header->mKinds || !valid(rec.mText) || !valid(rec.mFile))
+      return false;
+  }
+  return true;
+}
+
+bool
+TokenDump::valid(std::uint32_t offset) const
+{
+  auto size = mHeader->mStrings;
+  if (offset % 4 || offset > size || size - offset < 4)
+    return false;
+  auto len = *reinterpret_cast<const std::uint32_t*>(mStrings + offset);
+  return len < size - offset - 4 && mStrings[offset + 4 + len] == '\0';
+}
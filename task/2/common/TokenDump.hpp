@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief 二进制的词法单元流
+ *
+ * 由 clang -dump-tokens 的文本输出转换而来，文件布局为（整数均为本机字节序）：
+ *
+ *     Header | 种类表 mKinds × uint32 | Record × mCount | 字符串表
+ *
+ * 字符串表保存驻留后的种类名、词法单元文本和文件名，每个字符串前面是 4 字节
+ * 的长度，后面跟一个 '\0' 并填充到 4 字节对齐。种类表中是各个种类名在字符串
+ * 表中的偏移，Record::mKind 是种类表的下标，因此前端只需在打开时把每个种类
+ * 名映射一次，之后按下标查表即可，不再做任何文本解析。
+ *
+ * 读取时 TokenDump 只引用调用者提供的内存，自身不持有数据。
+ */
+class TokenDump
+{
+public:
+  static constexpr char kMagic[8] = { 'S', 'Y', 's', 'U', 'T', 'o', 'k', '1' };
+
+  struct Header
+  {
+    char mMagic[8];         ///< 固定为 kMagic
+    std::uint32_t mKinds;   ///< 种类表的项数
+    std::uint32_t mCount;   ///< 词法单元数
+    std::uint32_t mStrings; ///< 字符串表的字节数
+  };
+
+  struct Record
+  {
+    std::uint32_t mKind;   ///< 种类表的下标
+    std::uint32_t mText;   ///< 文本在字符串表中的偏移
+    std::uint32_t mFile;   ///< 文件名在字符串表中的偏移
+    std::uint32_t mLine;   ///< 行号
+    std::uint32_t mColumn; ///< 列号
+  };
+
+  /// 把文本格式的 \p text 转换为二进制格式写入 \p out 。成功时返回 0，
+  /// 失败时返回第一个无法解析的行的行号。
+  static std::size_t convert(std::string_view text, std::string& out);
+
+  /// 把文件 \p inPath 转换后写入 \p outPath ，返回值即进程退出码
+  static int pack(const char* inPath, const char* outPath);
+
+  /// 打开 \p data 处长为 \p size 的二进制词法单元流，格式不符时返回 false。
+  /// \p data 至少要按 4 字节对齐，并且在使用期间保持有效。
+  bool open(const char* data, std::size_t size);
+
+  std::uint32_t kinds() const { return mHeader->mKinds; }
+
+  /// 第 \p i 个种类的名字
+  std::string_view kind(std::uint32_t i) const { return str(mKinds[i]); }
+
+  std::uint32_t size() const { return mHeader->mCount; }
+
+  const Record& operator[](std::uint32_t i) const { return mRecords[i]; }
+
+  /// 字符串表中偏移为 \p offset 的字符串
+  std::string_view str(std::uint32_t offset) const
+  {
+    auto len = *reinterpret_cast<const std::uint32_t*>(mStrings + offset);
+    return { mStrings + offset + 4, len };
+  }
+
+private:
+  const Header* mHeader{ nullptr };
+  const std::uint32_t* mKinds{ nullptr };
+  const Record* mRecords{ nullptr };
+  const char* mStrings{ nullptr };
+
+  /// \p offset 处是否为完整的字符串
+  bool valid(std::uint32_t offset) const;
+};
@@ -0,0 +1,312 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+
+/// 词法单元的种类，kUnknown 表示查找失败
+enum class TokenKind : std::uint8_t
+{
+  kUnknown,
+  kEof,
+  kIdentifier,
+  kNumericConstant,
+  kCharConstant,
+  kStringLiteral,
+
+  // 关键字
+  kConst,
+  kInt,
+  kVoid,
+  kChar,
+  kLong,
+  kFloat,
+  kDouble,
+  kIf,
+  kElse,
+  kWhile,
+  kDo,
+  kFor,
+  kBreak,
+  kContinue,
+  kReturn,
+
+  // 标点
+  kLParen,
+  kRParen,
+  kLSquare,
+  kRSquare,
+  kLBrace,
+  kRBrace,
+  kSemi,
+  kComma,
+  kEqual,
+  kPlus,
+  kMinus,
+  kStar,
+  kSlash,
+  kPercent,
+  kExclaim,
+  kLess,
+  kGreater,
+  kLessEqual,
+  kGreaterEqual,
+  kEqualEqual,
+  kExclaimEqual,
+  kAmpAmp,
+  kPipePipe,
+};
+
+/// 每个种类的各种写法，次序与 TokenKind 一致
+struct TokenInfo
+{
+  TokenKind mKind;
+  std::string_view mClang; ///< clang -dump-tokens 中的种类名
+  std::string_view mAntlr; ///< ANTLR 文法中的词法规则名
+};
+
+inline constexpr TokenInfo kTokenInfos[] = {
+  { TokenKind::kUnknown, "", "" },
+  { TokenKind::kEof, "eof", "EOF" },
+  { TokenKind::kIdentifier, "identifier", "Identifier" },
+  { TokenKind::kNumericConstant, "numeric_constant", "Constant" },
+  { TokenKind::kCharConstant, "char_constant", "CharacterConstant" },
+  { TokenKind::kStringLiteral, "string_literal", "StringLiteral" },
+
+  { TokenKind::kConst, "const", "Const" },
+  { TokenKind::kInt, "int", "Int" },
+  { TokenKind::kVoid, "void", "Void" },
+  { TokenKind::kChar, "char", "Char" },
+  { TokenKind::kLong, "long", "Long" },
+  { TokenKind::kFloat, "float", "Float" },
+  { TokenKind::kDouble, "double", "Double" },
+  { TokenKind::kIf, "if", "If" },
+  { TokenKind::kElse, "else", "Else" },
+  { TokenKind::kWhile, "while", "While" },
+  { TokenKind::kDo, "do", "Do" },
+  { TokenKind::kFor, "for", "For" },
+  { TokenKind::kBreak, "break", "Break" },
+  { TokenKind::kContinue, "continue", "Continue" },
+  { TokenKind::kReturn, "return", "Return" },
+
+  { TokenKind::kLParen, "l_paren", "LeftParen" },
+  { TokenKind::kRParen, "r_paren", "RightParen" },
+  { TokenKind::kLSquare, "l_square", "LeftBracket" },
+  { TokenKind::kRSquare, "r_square", "RightBracket" },
+  { TokenKind::kLBrace, "l_brace", "LeftBrace" },
+  { TokenKind::kRBrace, "r_brace", "RightBrace" },
+  { TokenKind::kSemi, "semi", "Semi" },
+  { TokenKind::kComma, "comma", "Comma" },
+  { TokenKind::kEqual, "equal", "Equal" },
+  { TokenKind::kPlus, "plus", "Plus" },
+  { TokenKind::kMinus, "minus", "Minus" },
+  { TokenKind::kStar, "star", "Star" },
+  { TokenKind::kSlash, "slash", "Div" },
+  { TokenKind::kPercent, "percent", "Mod" },
+  { TokenKind::kExclaim, "exclaim", "Not" },
+  { TokenKind::kLess, "less", "Less" },
+  { TokenKind::kGreater, "greater", "Greater" },
+  { TokenKind::kLessEqual, "lessequal", "LessEqual" },
+  { TokenKind::kGreaterEqual, "greaterequal", "GreaterEqual" },
+  { TokenKind::kEqualEqual, "equalequal", "EqualEqual" },
+  { TokenKind::kExclaimEqual, "exclaimequal", "NotEqual" },
+  { TokenKind::kAmpAmp, "ampamp", "AndAnd" },
+  { TokenKind::kPipePipe, "pipepipe", "OrOr" },
+};
+
+inline constexpr std::size_t kTokenKinds = std::size(kTokenInfos);
+
+/**
+ * @brief 编译期构造的完美哈希表
+ *
+ * 采用“哈希-位移”的构造方法：键先按哈希值分到 kSlots 个桶里，再从大到小
+ * 为每个桶找一个位移，使桶中所有的键经位移后再混合一次的结果都落在空槽里。
+ * 查找时只算一次字符串哈希，取桶的位移得到唯一的槽，再比较一次字符串，
+ * 整个过程不分配内存。空的键不放入表中。
+ */
+template<std::size_t N>
+class PerfectHash
+{
+  static_assert(N < UINT16_MAX);
+
+public:
+  static constexpr std::size_t kSlots = [] {
+    std::size_t slots = 1;
+    while (slots < 2 * N)
+      slots *= 2;
+    return slots;
+  }();
+
+  constexpr explicit PerfectHash(const std::array<std::string_view, N>& keys)
+    : mKeys(keys)
+  {
+    for (auto& slot : mSlots)
+      slot = N;
+
+    std::array<std::uint32_t, N> hashes{};
+    std::array<std::size_t, kSlots> sizes{};
+    std::size_t maxSize = 0;
+    for (std::size_t i = 0; i < N; ++i) {
+      hashes[i] = hash(keys[i]);
+      if (!keys[i].empty())
+        maxSize = std::max(maxSize, ++sizes[hashes[i] & kMask]);
+    }
+
+    // 大桶的约束最多，先给它们找位移
+    for (auto size = maxSize; size > 0; --size) {
+      for (std::size_t bucket = 0; bucket < kSlots; ++bucket) {
+        if (sizes[bucket] != size)
+          continue;
+        std::uint32_t disp = 0;
+        while (!place(keys, hashes, bucket, disp)) {
+          if (++disp == kMaxDisp) {
+            mOk = false;
+            return;
+          }
+        }
+        mDisps[bucket] = disp;
+      }
+    }
+  }
+
+  /// 构造是否成功
+  constexpr bool ok() const { return mOk; }
+
+  /// 键 \p str 的下标，不存在时返回 N
+  constexpr std::size_t find(std::string_view str) const
+  {
+    auto h = hash(str);
+    auto i = mSlots[mix(h ^ mDisps[h & kMask]) & kMask];
+    return i != N && mKeys[i] == str ? i : N;
+  }
+
+private:
+  static constexpr std::size_t kMask = kSlots - 1;
+  static constexpr std::uint32_t kMaxDisp = 1 << 16;
+
+  std::array<std::string_view, N> mKeys;
+  std::array<std::uint32_t, kSlots> mDisps{};
+  std::array<std::uint16_t, kSlots> mSlots{}; ///< 槽中键的下标，N 表示空槽
+  bool mOk{ true };
+
+  /// FNV-1a
+  static constexpr std::uint32_t hash(std::string_view str)
+  {
+    std::uint32_t h = 2166136261u;
+    for (auto c : str)
+      h = (h ^ static_cast<unsigned char>(c)) * 16777619u;
+    return h;
+  }
+
+  /// MurmurHash3 的末端混合
+  static constexpr std::uint32_t mix(std::uint32_t h)
+  {
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+  }
+
+  /// 尝试以位移 \p disp 放置桶 \p bucket 中的所有键
+  constexpr bool place(const std::array<std::string_view, N>& keys,
+                       const std::array<std::uint32_t, N>& hashes,
+                       std::size_t bucket,
+                       std::uint32_t disp)
+  {
+    std::array<std::size_t, N> placed{};
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < N; ++i) {
+      if (keys[i].empty() || (hashes[i] & kMask) != bucket)
+        continue;
+      auto slot = mix(hashes[i] ^ disp) & kMask;
+      if (mSlots[slot] != N) {
+        // 与已放置的键冲突，撤销本桶已经放下的键
+        for (std::size_t j = 0; j < count; ++j)
+          mSlots[placed[j]] = N;
+        return false;
+      }
+      mSlots[slot] = i;
+      placed[count++] = slot;
+    }
+    return true;
+  }
+};
+
+namespace token_kinds {
+
+template<typename F>
+constexpr std::array<std::string_view, kTokenKinds>
+column(F key)
+{
+  std::array<std::string_view, kTokenKinds> keys{};
+  for (std::size_t i = 0; i < kTokenKinds; ++i)
+    keys[i] = key(kTokenInfos[i]);
+  return keys;
+}
+
+constexpr bool
+in_order()
+{
+  for (std::size_t i = 0; i < kTokenKinds; ++i)
+    if (kTokenInfos[i].mKind != TokenKind(i))
+      return false;
+  return true;
+}
+
+static_assert(in_order(), "kTokenInfos 的次序必须与 TokenKind 一致");
+
+inline constexpr PerfectHash<kTokenKinds> kClang(
+  column([](const TokenInfo& info) { return info.mClang; }));
+
+inline constexpr PerfectHash<kTokenKinds> kAntlr(
+  column([](const TokenInfo& info) { return info.mAntlr; }));
+
+static_assert(kClang.ok() && kAntlr.ok(),
+              "完美哈希构造失败，请调整哈希函数或槽数");
+
+constexpr TokenKind
+to_kind(std::size_t i)
+{
+  return i == kTokenKinds ? TokenKind::kUnknown : TokenKind(i);
+}
+
+} // namespace token_kinds
+
+/// clang -dump-tokens 中的种类名 \p name 对应的种类
+constexpr TokenKind
+clang_kind(std::string_view name)
+{
+  return token_kinds::to_kind(token_kinds::kClang.find(name));
+}
+
+/// ANTLR 文法中的词法规则名 \p name 对应的种类
+constexpr TokenKind
+antlr_kind(std::string_view name)
+{
+  return token_kinds::to_kind(token_kinds::kAntlr.find(name));
+}
+
+/// 种类 \p kind 在 clang -dump-tokens 中的名字
+constexpr std::string_view
+clang_name(TokenKind kind)
+{
+  return kTokenInfos[std::size_t(kind)].mClang;
+}
+
+/// 以 TokenKind 为下标的查找表，\p pairs 中没有列出的种类取 \p fallback
+template<typename T, std::size_t M>
+constexpr std::array<T, kTokenKinds>
+token_table(T fallback, const std::pair<TokenKind, T> (&pairs)[M])
+{
+  std::array<T, kTokenKinds> table{};
+  for (auto& value : table)
+    value = fallback;
+  for (auto& [kind, value] : pairs)
+    table[std::size_t(kind)] = value;
+  return table;
+}
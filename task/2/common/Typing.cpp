@@ -20,31 +20,15 @@ Typing::operator()(TranslationUnit* tu)
 Expr*
 Typing::operator()(Expr* obj)
 {
-  if (auto p = obj->dcst<IntegerLiteral>())
-    return self(p);
-
-  if (auto p = obj->dcst<StringLiteral>())
-    return self(p);
-
-  if (auto p = obj->dcst<DeclRefExpr>())
-    return self(p);
-
-  if (auto p = obj->dcst<ParenExpr>())
-    return self(p);
-
-  if (auto p = obj->dcst<UnaryExpr>())
-    return self(p);
-
-  if (auto p = obj->dcst<BinaryExpr>())
-    return self(p);
-
-  if (auto p = obj->dcst<CallExpr>())
-    return self(p);
-
-  if (auto p = obj->dcst<ImplicitCastExpr>())
-    return self(p->sub);
+  return visit<Expr*>(
+    obj, [&](auto p) -> decltype(self(p)) { return self(p); });
+}
 
-  ABORT();
+Expr*
+Typing::operator()(ImplicitCastExpr* obj)
+{
+  // 已有的隐式转换会在重新推导时按需再生成
+  return self(obj->sub);
 }
 
 Expr*
@@ -258,14 +242,10 @@ Typing::operator()(CallExpr* obj)
   auto f2p = make<ImplicitCastExpr>();
   f2p->kind = ImplicitCastExpr::kFunctionToPointerDecay;
   // 加上指针类型
-  auto type = make<Type>();
-  auto pointerType = make<PointerType>();
-  type->spec = obj->head->type->spec;
-  type->qual = obj->head->type->qual;
-  pointerType->sub = obj->head->type->texp;
-  type->texp = pointerType;
-
-  f2p->type = type;
+  PointerType pointerType;
+  pointerType.sub = obj->head->type->texp;
+  f2p->type =
+    mTypeCache(obj->head->type->spec, obj->head->type->qual, &pointerType);
   f2p->sub = obj->head;
   obj->head = f2p;
 
@@ -292,37 +272,13 @@ Typing::operator()(CallExpr* obj)
 void
 Typing::operator()(Stmt* obj)
 {
-  if (auto p = obj->dcst<DeclStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<ExprStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<CompoundStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<IfStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<WhileStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<DoStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<BreakStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<ContinueStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<ReturnStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<NullStmt>())
-    return;
+  return visit<void>(
+    obj, [&](auto p) -> decltype(self(p)) { return self(p); });
+}
 
-  ABORT();
+void
+Typing::operator()(NullStmt* obj)
+{
 }
 
 void
@@ -417,13 +373,8 @@ Typing::operator()(ReturnStmt* obj)
 void
 Typing::operator()(Decl* obj)
 {
-  if (auto p = obj->dcst<VarDecl>())
-    return self(p);
-
-  if (auto p = obj->dcst<FunctionDecl>())
-    return self(p);
-
-  ABORT();
+  return visit<void>(
+    obj, [&](auto p) -> decltype(self(p)) { return self(p); });
 }
 
 void
@@ -446,6 +397,16 @@ Typing::operator()(VarDecl* obj)
     ty.type = obj->type;
     ty.cate = Expr::Cate::kLValue;
     obj->init = infer_init(obj->init, obj->type);
+
+    // 未知长度的数组由初始化确定长度。缓存中的类型是共享的，不能原地修改，
+    // 而是换成新长度的类型。
+    auto arrTy = obj->type->texp ? obj->type->texp->dcst<ArrayType>() : nullptr;
+    if (arrTy && arrTy->len == ArrayType::kUnLen) {
+      ArrayType sized;
+      sized.len = obj->init->type->texp->scst<ArrayType>()->len;
+      sized.sub = arrTy->sub;
+      obj->type = mTypeCache(obj->type->spec, obj->type->qual, &sized);
+    }
   }
 }
 
@@ -477,12 +438,10 @@ Typing::operator()(FunctionDecl* obj)
     funcType->params[i] = obj->params[i]->type;
     // 将此处Arraytype变为PointerType
     if (obj->params[i]->type->texp->dcst<ArrayType>()) {
-      auto type = make<Type>();
-      type->spec = obj->params[i]->type->spec;
-      type->qual = obj->params[i]->type->qual;
-      auto pointerType = make<PointerType>();
-      pointerType->sub = obj->params[i]->type->texp;
-      type->texp = pointerType;
+      PointerType pointerType;
+      pointerType.sub = obj->params[i]->type->texp;
+      auto type = mTypeCache(
+        obj->params[i]->type->spec, obj->params[i]->type->qual, &pointerType);
       // 两个都要改
       funcType->params[i] = type;
       obj->params[i]->type = type;
@@ -507,14 +466,9 @@ Typing::ensure_rvalue(Expr* exp)
     cst->kind = ImplicitCastExpr::kArrayToPointerDecay;
 
     // 加上指针类型
-    auto type = make<Type>();
-    auto pointerType = make<PointerType>();
-    type->spec = exp->type->spec;
-    type->qual = exp->type->qual;
-    pointerType->sub = exp->type->texp;
-    type->texp = pointerType;
-
-    cst->type = mTypeCache(type->spec, type->qual, type->texp);
+    PointerType pointerType;
+    pointerType.sub = exp->type->texp;
+    cst->type = mTypeCache(exp->type->spec, exp->type->qual, &pointerType);
     cst->cate = Expr::Cate::kRValue;
 
     cst->sub = exp;
@@ -702,10 +656,13 @@ Typing::infer_init(Expr* init, const Type* to)
       auto p = init->type->texp->dcst<ArrayType>();
       if (!p || p->sub != nullptr || init->type->spec != Type::Spec::kChar)
         ABORT();
-      if (arrTy->len == -1)
-        arrTy->len = p->len;
-      else
-        p->len = arrTy->len;
+      // 未知长度时保留字符串的类型，由调用者据此确定数组的长度
+      if (arrTy->len != ArrayType::kUnLen && p->len != arrTy->len) {
+        // 缓存中的类型是共享的，不能原地修改长度，而是换成新长度的类型
+        ArrayType resized;
+        resized.len = arrTy->len;
+        init->type = mTypeCache(init->type->spec, init->type->qual, &resized);
+      }
 
       return init;
     }
@@ -731,21 +688,18 @@ Typing::infer_initlist(const std::vector<Expr*>& list,
 
   if (auto arrTy = to->texp->dcst<ArrayType>()) {
     auto ret = make<InitListExpr>();
-    ret->type = mTypeCache(to->spec, to->qual, to->texp);
     ret->cate = Expr::Cate::kRValue;
 
-    Type elemTy;
-    elemTy.spec = to->spec;
-    elemTy.qual = to->qual;
-    elemTy.texp = arrTy->sub;
+    auto elemTy = mTypeCache(to->spec, to->qual, arrTy->sub);
 
-    if (arrTy->len == ArrayType::kUnLen) {
-      arrTy->len = 0;
+    std::uint32_t len = arrTy->len;
+    if (len == ArrayType::kUnLen) {
+      len = 0;
       while (begin < list.size()) {
-        auto [expr, next] = infer_initlist(list, begin, &elemTy);
+        auto [expr, next] = infer_initlist(list, begin, elemTy);
         ret->list.push_back(expr);
         begin = next;
-        ++arrTy->len;
+        ++len;
       }
     }
 
@@ -753,12 +707,18 @@ Typing::infer_initlist(const std::vector<Expr*>& list,
       for (int i = 0; i < arrTy->len; ++i) {
         if (begin == list.size())
           break;
-        auto [expr, next] = infer_initlist(list, begin, &elemTy);
+        auto [expr, next] = infer_initlist(list, begin, elemTy);
         ret->list.push_back(expr);
         begin = next;
       }
     }
 
+    // 未知长度的数组在上面才确定长度，缓存中的类型不能原地修改，因此按
+    // 确定后的长度重新查找类型缓存
+    ArrayType sized;
+    sized.len = len;
+    sized.sub = arrTy->sub;
+    ret->type = mTypeCache(to->spec, to->qual, &sized);
     return { ret, begin };
   }
 
@@ -46,12 +46,16 @@ private:
 
   Expr* operator()(CallExpr* obj);
 
+  Expr* operator()(ImplicitCastExpr* obj);
+
   //============================================================================
   // 语句
   //============================================================================
 
   void operator()(Stmt* obj);
 
+  void operator()(NullStmt* obj);
+
   void operator()(DeclStmt* obj);
 
   void operator()(ExprStmt* obj);
@@ -1,5 +1,7 @@
 #include "asg.hpp"
 
+#define self (*this)
+
 namespace asg {
 
 //==============================================================================
@@ -22,23 +24,104 @@ Type::__mark__(Mark mark)
   mark(texp);
 }
 
+namespace {
+
+/// 将 \p val 的字节追加到哈希键 \p key 的末尾
+template<typename T>
+void
+encode(std::string& key, const T& val)
+{
+  key.append(reinterpret_cast<const char*>(&val), sizeof(val));
+}
+
+} // namespace
+
 const Type*
 Type::Cache::operator()(Spec spec, Qual qual, TypeExpr* texp)
 {
-  for (auto&& i : *this) {
-    if (i->spec == spec && i->qual == qual) {
-      if (texp == i->texp)
-        return i;
-      if (texp == nullptr || i->texp == nullptr)
-        continue;
-      if (*texp == *i->texp)
-        return i;
+  texp = self(texp);
+
+  std::string key;
+  encode(key, spec);
+  encode(key, qual.const_);
+  encode(key, texp);
+
+  auto [iter, fresh] = mTypes.try_emplace(std::move(key), nullptr);
+  if (fresh) {
+    auto ty = mMgr.make<Type>();
+    ty->spec = spec, ty->qual = qual, ty->texp = texp;
+    iter->second = ty;
+  }
+  return iter->second;
+}
+
+TypeExpr*
+Type::Cache::operator()(TypeExpr* texp)
+{
+  if (texp == nullptr || mCanonTexps.count(texp))
+    return texp;
+
+  // 子结点先规范化，这样子结构只需按指针编码
+  auto sub = self(texp->sub);
+
+  std::string key;
+  std::vector<const Type*> params;
+  encode(key, sub);
+  if (auto p = texp->dcst<PointerType>()) {
+    key.push_back('*');
+    encode(key, p->qual.const_);
+  }
+
+  else if (auto p = texp->dcst<ArrayType>()) {
+    key.push_back('[');
+    encode(key, p->len);
+  }
+
+  else if (auto p = texp->dcst<FunctionType>()) {
+    key.push_back('(');
+    for (auto&& i : p->params) {
+      params.push_back(self(i->spec, i->qual, i->texp));
+      encode(key, params.back());
     }
   }
-  auto ty = mMgr.make<Type>();
-  ty->spec = spec, ty->qual = qual, ty->texp = texp;
-  push_back(ty);
-  return ty;
+
+  else
+    ABORT();
+
+  auto [iter, fresh] = mTexps.try_emplace(std::move(key), nullptr);
+  if (!fresh)
+    return iter->second;
+
+  TypeExpr* ret;
+  if (auto p = texp->dcst<PointerType>()) {
+    auto q = mMgr.make<PointerType>();
+    q->qual = p->qual;
+    ret = q;
+  }
+
+  else if (auto p = texp->dcst<ArrayType>()) {
+    auto q = mMgr.make<ArrayType>();
+    q->len = p->len;
+    ret = q;
+  }
+
+  else {
+    auto q = mMgr.make<FunctionType>();
+    q->params = std::move(params);
+    ret = q;
+  }
+
+  ret->sub = sub;
+  mCanonTexps.insert(ret);
+  return iter->second = ret;
+}
+
+void
+Type::Cache::clear()
+{
+  mTypes.clear();
+  mTexps.clear();
+  mCanonTexps.clear();
 }
 
 bool
@@ -58,7 +141,7 @@ PointerType::__equal__(const TypeExpr& other) const
 {
   if (this == &other)
     return true;
-  auto p = dynamic_cast<const PointerType*>(&other);
+  auto p = other.dcst<const PointerType>();
   if (p == nullptr)
     return false;
 
@@ -72,7 +155,7 @@ ArrayType::__equal__(const TypeExpr& other) const
 {
   if (this == &other)
     return true;
-  auto p = dynamic_cast<const ArrayType*>(&other);
+  auto p = other.dcst<const ArrayType>();
   if (p == nullptr)
     return false;
 
@@ -94,7 +177,7 @@ FunctionType::__equal__(const TypeExpr& other) const
 {
   if (this == &other)
     return true;
-  auto p = dynamic_cast<const FunctionType*>(&other);
+  auto p = other.dcst<const FunctionType>();
   if (p == nullptr)
     return false;
 
@@ -1,10 +1,67 @@
 #pragma once
 
+#include "Atom.hpp"
 #include "Obj.hpp"
 #include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace asg {
 
+/// 结点的种类标签，构造时写入 Obj，用于快速判断结点的具体类型（见 Obj::dcst
+/// 和下文的 visit）。同一基类的子类连续编号，因此基类的 classof 只需比较区间。
+enum struct Kind : std::uint8_t
+{
+  kINVALID,
+
+  kType,
+  kPointerType,
+  kArrayType,
+  kFunctionType,
+
+  kExpr,
+  kIntegerLiteral,
+  kStringLiteral,
+  kDeclRefExpr,
+  kParenExpr,
+  kUnaryExpr,
+  kBinaryExpr,
+  kCallExpr,
+  kInitListExpr,
+  kImplicitInitExpr,
+  kImplicitCastExpr,
+
+  kNullStmt,
+  kDeclStmt,
+  kExprStmt,
+  kCompoundStmt,
+  kIfStmt,
+  kWhileStmt,
+  kDoStmt,
+  kBreakStmt,
+  kContinueStmt,
+  kReturnStmt,
+
+  kDecl,
+  kVarDecl,
+  kFunctionDecl,
+
+  kTranslationUnit,
+};
+
+/// 为具体的结点类生成默认构造函数和 classof。
+#define ASG_KIND(cls, base)                                                    \
+  cls()                                                                        \
+    : base(Kind::k##cls)                                                       \
+  {                                                                            \
+  }                                                                            \
+                                                                               \
+  static bool classof(const Obj* obj)                                          \
+  {                                                                            \
+    return obj->kind<Kind>() == Kind::k##cls;                                  \
+  }
+
 //==============================================================================
 // 类型
 //==============================================================================
@@ -15,6 +72,16 @@ struct Decl;
 
 struct Type : Obj
 {
+  Type()
+    : Obj(std::uint8_t(Kind::kType))
+  {
+  }
+
+  static bool classof(const Obj* obj)
+  {
+    return obj->kind<Kind>() == Kind::kType;
+  }
+
   /// 说明（Specifier）
   enum struct Spec : std::uint8_t
   {
@@ -57,11 +124,18 @@ public:
    *
    * 编译过程中，尤其是语法分析和类型推导阶段，会有大量的语义节点包含相同的
    * 类型或子类型，重复创建这些类型节点会导致无谓的内存占用，因此使用这个类
-   * 型缓存器。考虑到我们测例中不会包含太多的类型种类，这里的实现采用了简单
-   * 的线性查找算法，更高级的做法是设计有唯一性的类型编码方法，然后使用哈希
-   * 表来映射和查找。
+   * 型缓存器。
+   *
+   * 缓存采用哈希合并（hash-consing）的做法：类型表达式结点按“种类 + 自身属
+   * 性 + 已规范化的子结点指针”编码为唯一的键，类型按“说明 + 限定 + 已规范化
+   * 的类型表达式指针”编码，然后用哈希表映射到唯一的规范结点。这样每次查找
+   * 只需常数次哈希表操作，并且缓存返回的两个类型结构相等当且仅当指针相等。
+   *
+   * 传入的类型表达式只会被读取（可以是栈上的临时对象），缓存未命中时会复制
+   * 出新的规范结点。缓存返回的结点被多处共享，不得再修改。缓存本身不是垃圾
+   * 回收的根，在回收前需要先 clear。
    */
-  struct Cache : std::vector<const Type*>
+  struct Cache
   {
     Obj::Mgr& mMgr;
 
@@ -71,11 +145,28 @@ public:
     }
 
     const Type* operator()(Spec spec, Qual qual, TypeExpr* texp);
+
+    /// 返回与 \p texp 结构相等的规范类型表达式
+    TypeExpr* operator()(TypeExpr* texp);
+
+    /// 清空缓存，此后缓存持有的结点才可以被垃圾回收
+    void clear();
+
+  private:
+    std::unordered_map<std::string, const Type*> mTypes;
+    std::unordered_map<std::string, TypeExpr*> mTexps;
+    std::unordered_set<const TypeExpr*> mCanonTexps; ///< 已规范化的结点
   };
 };
 
 struct TypeExpr : Obj
 {
+  static bool classof(const Obj* obj)
+  {
+    auto kind = obj->kind<Kind>();
+    return Kind::kPointerType <= kind && kind <= Kind::kFunctionType;
+  }
+
   TypeExpr* sub{ nullptr };
 
   bool operator==(const TypeExpr& other) const
@@ -90,6 +181,11 @@ struct TypeExpr : Obj
   bool operator!=(const TypeExpr& other) const { return !operator==(other); }
 
 protected:
+  explicit TypeExpr(Kind kind)
+    : Obj(std::uint8_t(kind))
+  {
+  }
+
   void __mark__(Mark mark) override;
 
 private:
@@ -98,6 +194,8 @@ private:
 
 struct PointerType : TypeExpr
 {
+  ASG_KIND(PointerType, TypeExpr)
+
   Type::Qual qual;
 
 private:
@@ -106,6 +204,8 @@ private:
 
 struct ArrayType : TypeExpr
 {
+  ASG_KIND(ArrayType, TypeExpr)
+
   std::uint32_t len{ 0 }; /// 数组长度，kUnLen 表示未知
   static constexpr std::uint32_t kUnLen = UINT32_MAX;
 
@@ -115,6 +215,8 @@ private:
 
 struct FunctionType : TypeExpr
 {
+  ASG_KIND(FunctionType, TypeExpr)
+
   std::vector<const Type*> params;
 
 private:
@@ -130,6 +232,17 @@ struct Decl;
 
 struct Expr : Obj
 {
+  Expr()
+    : Expr(Kind::kExpr)
+  {
+  }
+
+  static bool classof(const Obj* obj)
+  {
+    auto kind = obj->kind<Kind>();
+    return Kind::kExpr <= kind && kind <= Kind::kImplicitCastExpr;
+  }
+
   enum struct Cate : std::uint8_t
   {
     kINVALID,
@@ -137,25 +250,36 @@ struct Expr : Obj
     kLValue,
   };
 
-  const Type* type;
+  const Type* type{ nullptr };
   Cate cate{ Cate::kINVALID };
 
 protected:
+  explicit Expr(Kind kind)
+    : Obj(std::uint8_t(kind))
+  {
+  }
+
   void __mark__(Mark mark) override;
 };
 
 struct IntegerLiteral : Expr
 {
+  ASG_KIND(IntegerLiteral, Expr)
+
   std::uint64_t val{ 0 };
 };
 
 struct StringLiteral : Expr
 {
+  ASG_KIND(StringLiteral, Expr)
+
   std::string val;
 };
 
 struct DeclRefExpr : Expr
 {
+  ASG_KIND(DeclRefExpr, Expr)
+
   Decl* decl{ nullptr };
 
 private:
@@ -164,6 +288,8 @@ private:
 
 struct ParenExpr : Expr
 {
+  ASG_KIND(ParenExpr, Expr)
+
   Expr* sub{ nullptr };
 
 private:
@@ -172,6 +298,8 @@ private:
 
 struct UnaryExpr : Expr
 {
+  ASG_KIND(UnaryExpr, Expr)
+
   enum Op
   {
     kINVALID,
@@ -189,6 +317,8 @@ private:
 
 struct BinaryExpr : Expr
 {
+  ASG_KIND(BinaryExpr, Expr)
+
   enum Op
   {
     kINVALID,
@@ -219,6 +349,8 @@ private:
 
 struct CallExpr : Expr
 {
+  ASG_KIND(CallExpr, Expr)
+
   Expr* head{ nullptr };
   std::vector<Expr*> args;
 
@@ -228,6 +360,8 @@ private:
 
 struct InitListExpr : Expr
 {
+  ASG_KIND(InitListExpr, Expr)
+
   std::vector<Expr*> list;
 
 private:
@@ -235,10 +369,14 @@ private:
 };
 
 struct ImplicitInitExpr : Expr
-{};
+{
+  ASG_KIND(ImplicitInitExpr, Expr)
+};
 
 struct ImplicitCastExpr : Expr
 {
+  ASG_KIND(ImplicitCastExpr, Expr)
+
   enum
   {
     kINVALID,
@@ -261,16 +399,32 @@ private:
 struct FunctionDecl;
 
 struct Stmt : Obj
-{};
+{
+  static bool classof(const Obj* obj)
+  {
+    auto kind = obj->kind<Kind>();
+    return Kind::kNullStmt <= kind && kind <= Kind::kReturnStmt;
+  }
+
+protected:
+  explicit Stmt(Kind kind)
+    : Obj(std::uint8_t(kind))
+  {
+  }
+};
 
 struct NullStmt : Stmt
 {
+  ASG_KIND(NullStmt, Stmt)
+
 protected:
   void __mark__(Mark mark) override;
 };
 
 struct DeclStmt : Stmt
 {
+  ASG_KIND(DeclStmt, Stmt)
+
   std::vector<Decl*> decls;
 
 private:
@@ -279,6 +433,8 @@ private:
 
 struct ExprStmt : Stmt
 {
+  ASG_KIND(ExprStmt, Stmt)
+
   Expr* expr{ nullptr };
 
 private:
@@ -287,6 +443,8 @@ private:
 
 struct CompoundStmt : Stmt
 {
+  ASG_KIND(CompoundStmt, Stmt)
+
   std::vector<Stmt*> subs;
 
 private:
@@ -295,6 +453,8 @@ private:
 
 struct IfStmt : Stmt
 {
+  ASG_KIND(IfStmt, Stmt)
+
   Expr* cond{ nullptr };
   Stmt *then{ nullptr }, *else_{ nullptr };
 
@@ -304,6 +464,8 @@ private:
 
 struct WhileStmt : Stmt
 {
+  ASG_KIND(WhileStmt, Stmt)
+
   Expr* cond{ nullptr };
   Stmt* body{ nullptr };
 
@@ -313,6 +475,8 @@ private:
 
 struct DoStmt : Stmt
 {
+  ASG_KIND(DoStmt, Stmt)
+
   Stmt* body{ nullptr };
   Expr* cond{ nullptr };
 
@@ -322,6 +486,8 @@ private:
 
 struct BreakStmt : Stmt
 {
+  ASG_KIND(BreakStmt, Stmt)
+
   Stmt* loop{ nullptr };
 
 private:
@@ -330,6 +496,8 @@ private:
 
 struct ContinueStmt : Stmt
 {
+  ASG_KIND(ContinueStmt, Stmt)
+
   Stmt* loop{ nullptr };
 
 private:
@@ -338,6 +506,8 @@ private:
 
 struct ReturnStmt : Stmt
 {
+  ASG_KIND(ReturnStmt, Stmt)
+
   FunctionDecl* func{ nullptr };
   Expr* expr{ nullptr };
 
@@ -351,15 +521,33 @@ private:
 
 struct Decl : Obj
 {
-  const Type* type;
-  std::string name;
+  Decl()
+    : Decl(Kind::kDecl)
+  {
+  }
+
+  static bool classof(const Obj* obj)
+  {
+    auto kind = obj->kind<Kind>();
+    return Kind::kDecl <= kind && kind <= Kind::kFunctionDecl;
+  }
+
+  const Type* type{ nullptr };
+  Atom name{};
 
 protected:
+  explicit Decl(Kind kind)
+    : Obj(std::uint8_t(kind))
+  {
+  }
+
   void __mark__(Mark mark) override;
 };
 
 struct VarDecl : Decl
 {
+  ASG_KIND(VarDecl, Decl)
+
   Expr* init{ nullptr };
 
 private:
@@ -368,6 +556,8 @@ private:
 
 struct FunctionDecl : Decl
 {
+  ASG_KIND(FunctionDecl, Decl)
+
   std::vector<Decl*> params;
   CompoundStmt* body{ nullptr };
 
@@ -381,10 +571,159 @@ private:
 
 struct TranslationUnit : Obj
 {
+  TranslationUnit()
+    : Obj(std::uint8_t(Kind::kTranslationUnit))
+  {
+  }
+
+  static bool classof(const Obj* obj)
+  {
+    return obj->kind<Kind>() == Kind::kTranslationUnit;
+  }
+
   std::vector<Decl*> decls;
 
 private:
   void __mark__(Mark mark) override;
 };
 
+//==============================================================================
+// 分派
+//==============================================================================
+
+/**
+ * @brief 只能隐式转换为 `T*` 的指针包装
+ *
+ * visit 以它作为实参调用遍历函数，使得重载决议只会选中参数恰为 `T*` 的
+ * operator()，而不会退而选中基类指针的重载（那样会无限递归）。
+ */
+template<typename T>
+struct Exact
+{
+  T* mPtr;
+
+  template<typename U, typename = std::enable_if_t<std::is_same_v<U, T*>>>
+  operator U() const
+  {
+    return mPtr;
+  }
+};
+
+namespace details {
+
+template<typename R, typename T, typename F>
+R
+visit_as(Obj* obj, F& f)
+{
+  if constexpr (std::is_invocable_v<F&, Exact<T>>)
+    return f(Exact<T>{ static_cast<T*>(obj) });
+  else
+    ABORT();
+}
+
+} // namespace details
+
+/**
+ * @brief 按种类标签分派
+ *
+ * 根据 obj 的种类，用一次 switch 以具体子类的指针调用 f，代替逐个尝试
+ * dcst 的 if 链。遍历器通常这样使用：
+ *
+ * ```cpp
+ * return visit<Expr*>(
+ *   obj, [&](auto p) -> decltype(self(p)) { return self(p); });
+ * ```
+ *
+ * 遍历器为某个子类提供了 operator() 重载时就会被自动分派到，没有提供则中止。
+ */
+template<typename R, typename F>
+R
+visit(TypeExpr* obj, F&& f)
+{
+  switch (obj->kind<Kind>()) {
+    case Kind::kPointerType:
+      return details::visit_as<R, PointerType>(obj, f);
+    case Kind::kArrayType:
+      return details::visit_as<R, ArrayType>(obj, f);
+    case Kind::kFunctionType:
+      return details::visit_as<R, FunctionType>(obj, f);
+    default:
+      ABORT();
+  }
+}
+
+template<typename R, typename F>
+R
+visit(Expr* obj, F&& f)
+{
+  switch (obj->kind<Kind>()) {
+    case Kind::kIntegerLiteral:
+      return details::visit_as<R, IntegerLiteral>(obj, f);
+    case Kind::kStringLiteral:
+      return details::visit_as<R, StringLiteral>(obj, f);
+    case Kind::kDeclRefExpr:
+      return details::visit_as<R, DeclRefExpr>(obj, f);
+    case Kind::kParenExpr:
+      return details::visit_as<R, ParenExpr>(obj, f);
+    case Kind::kUnaryExpr:
+      return details::visit_as<R, UnaryExpr>(obj, f);
+    case Kind::kBinaryExpr:
+      return details::visit_as<R, BinaryExpr>(obj, f);
+    case Kind::kCallExpr:
+      return details::visit_as<R, CallExpr>(obj, f);
+    case Kind::kInitListExpr:
+      return details::visit_as<R, InitListExpr>(obj, f);
+    case Kind::kImplicitInitExpr:
+      return details::visit_as<R, ImplicitInitExpr>(obj, f);
+    case Kind::kImplicitCastExpr:
+      return details::visit_as<R, ImplicitCastExpr>(obj, f);
+    default:
+      ABORT();
+  }
+}
+
+template<typename R, typename F>
+R
+visit(Stmt* obj, F&& f)
+{
+  switch (obj->kind<Kind>()) {
+    case Kind::kNullStmt:
+      return details::visit_as<R, NullStmt>(obj, f);
+    case Kind::kDeclStmt:
+      return details::visit_as<R, DeclStmt>(obj, f);
+    case Kind::kExprStmt:
+      return details::visit_as<R, ExprStmt>(obj, f);
+    case Kind::kCompoundStmt:
+      return details::visit_as<R, CompoundStmt>(obj, f);
+    case Kind::kIfStmt:
+      return details::visit_as<R, IfStmt>(obj, f);
+    case Kind::kWhileStmt:
+      return details::visit_as<R, WhileStmt>(obj, f);
+    case Kind::kDoStmt:
+      return details::visit_as<R, DoStmt>(obj, f);
+    case Kind::kBreakStmt:
+      return details::visit_as<R, BreakStmt>(obj, f);
+    case Kind::kContinueStmt:
+      return details::visit_as<R, ContinueStmt>(obj, f);
+    case Kind::kReturnStmt:
+      return details::visit_as<R, ReturnStmt>(obj, f);
+    default:
+      ABORT();
+  }
+}
+
+template<typename R, typename F>
+R
+visit(Decl* obj, F&& f)
+{
+  switch (obj->kind<Kind>()) {
+    case Kind::kVarDecl:
+      return details::visit_as<R, VarDecl>(obj, f);
+    case Kind::kFunctionDecl:
+      return details::visit_as<R, FunctionDecl>(obj, f);
+    default:
+      ABORT();
+  }
+}
+
 } // namespace asg
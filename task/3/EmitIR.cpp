@@ -63,10 +63,9 @@ EmitIR::operator()(const Type* type)
 llvm::Value*
 EmitIR::operator()(Expr* obj)
 {
-  // TODO: 在此添加对更多表达式处理的跳转
-  if (auto p = obj->dcst<IntegerLiteral>())
-    return self(p);
-  ABORT();
+  // 为更多表达式类型添加 operator() 重载后，这里会自动跳转过去
+  return visit<llvm::Value*>(
+    obj, [&](auto p) -> decltype(self(p)) { return self(p); });
 }
 
 llvm::Constant*
@@ -84,15 +83,9 @@ EmitIR::operator()(IntegerLiteral* obj)
 void
 EmitIR::operator()(Stmt* obj)
 {
-  // TODO: 在此添加对更多Stmt类型的处理的跳转
-
-  if (auto p = obj->dcst<CompoundStmt>())
-    return self(p);
-
-  if (auto p = obj->dcst<ReturnStmt>())
-    return self(p);
-
-  ABORT();
+  // 为更多Stmt类型添加 operator() 重载后，这里会自动跳转过去
+  return visit<void>(
+    obj, [&](auto p) -> decltype(self(p)) { return self(p); });
 }
 
 // TODO: 在此添加对更多Stmt类型的处理
@@ -129,12 +122,9 @@ EmitIR::operator()(ReturnStmt* obj)
 void
 EmitIR::operator()(Decl* obj)
 {
-  // TODO: 添加变量声明处理的跳转
-
-  if (auto p = obj->dcst<FunctionDecl>())
-    return self(p);
-
-  ABORT();
+  // 添加变量声明的 operator() 重载后，这里会自动跳转过去
+  return visit<void>(
+    obj, [&](auto p) -> decltype(self(p)) { return self(p); });
 }
 
 // TODO: 添加变量声明的处理
@@ -145,7 +135,7 @@ EmitIR::operator()(FunctionDecl* obj)
   // 创建函数
   auto fty = llvm::dyn_cast<llvm::FunctionType>(self(obj->type));
   auto func = llvm::Function::Create(
-    fty, llvm::GlobalVariable::ExternalLinkage, obj->name, mMod);
+    fty, llvm::GlobalVariable::ExternalLinkage, obj->name.str(), mMod);
 
   obj->any = func;
 
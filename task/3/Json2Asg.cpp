@@ -1,4 +1,6 @@
 #include "Json2Asg.hpp"
+#include <charconv>
+#include <llvm/ADT/SmallVector.h>
 
 using namespace asg;
 
@@ -25,14 +27,92 @@ Json2Asg::operator()(const llvm::json::Value& jval)
 
 namespace {
 
+/// 解析形如 0x1a2b 的结点编号
+std::size_t
+parse_id(std::string_view id)
+{
+  ASSERT(id.substr(0, 2) == "0x");
+  std::size_t ret;
+  auto end = id.data() + id.size();
+  auto [ptr, ec] = std::from_chars(id.data() + 2, end, ret, 16);
+  ASSERT(ec == std::errc() && ptr == end);
+  return ret;
+}
+
 std::size_t
 jobj_id(const llvm::json::Object& jobj)
 {
   auto id = jobj.getString("id");
   ASSERT(id);
-  ASSERT(id->starts_with("0x"));
-  auto hexStr = id->substr(2).str();
-  return std::stoull(hexStr, nullptr, 16);
+  return parse_id(*id);
+}
+
+Expr::Cate
+value_category(std::string_view cate)
+{
+  if (cate == "lvalue")
+    return Expr::Cate::kLValue;
+  if (cate == "prvalue")
+    return Expr::Cate::kRValue;
+  ABORT();
+}
+
+UnaryExpr::Op
+unary_op(std::string_view opCode)
+{
+  if (opCode == "-")
+    return UnaryExpr::Op::kNeg;
+  if (opCode == "!")
+    return UnaryExpr::Op::kNot;
+  if (opCode == "+")
+    return UnaryExpr::Op::kPos;
+  ABORT();
+}
+
+BinaryExpr::Op
+binary_op(std::string_view opCode)
+{
+  if (opCode == "*")
+    return BinaryExpr::Op::kMul;
+  if (opCode == "/")
+    return BinaryExpr::Op::kDiv;
+  if (opCode == "%")
+    return BinaryExpr::Op::kMod;
+  if (opCode == "+")
+    return BinaryExpr::Op::kAdd;
+  if (opCode == "-")
+    return BinaryExpr::Op::kSub;
+  if (opCode == ">")
+    return BinaryExpr::Op::kGt;
+  if (opCode == "<")
+    return BinaryExpr::Op::kLt;
+  if (opCode == ">=")
+    return BinaryExpr::Op::kGe;
+  if (opCode == "<=")
+    return BinaryExpr::Op::kLe;
+  if (opCode == "==")
+    return BinaryExpr::Op::kEq;
+  if (opCode == "!=")
+    return BinaryExpr::Op::kNe;
+  if (opCode == "&&")
+    return BinaryExpr::Op::kAnd;
+  if (opCode == "||")
+    return BinaryExpr::Op::kOr;
+  if (opCode == "=")
+    return BinaryExpr::Op::kAssign;
+  ABORT();
+}
+
+decltype(ImplicitCastExpr::kind)
+cast_kind(std::string_view castKind)
+{
+  if (castKind == "LValueToRValue")
+    return ImplicitCastExpr::kLValueToRValue;
+  if (castKind == "ArrayToPointerDecay")
+    return ImplicitCastExpr::kArrayToPointerDecay;
+  if (castKind == "FunctionToPointerDecay")
+    return ImplicitCastExpr::kFunctionToPointerDecay;
+  ABORT();
 }
 
 } // namespace
@@ -48,14 +128,23 @@ Json2Asg::getty(const llvm::json::Object& jobj)
   ASSERT(a);
   auto b = a->getString("qualType");
   ASSERT(b);
-  auto texpStr = b->str();
+  return getty(std::string_view(*b));
+}
+
+const Type*
+Json2Asg::getty(std::string_view qualType)
+{
+  ASSERT(!qualType.empty());
+  Atom texpStr = qualType;
 
   auto iter = mTyMap.find(texpStr);
   if (iter != mTyMap.end())
     return iter->second;
 
+  // 原子的内容不保证以 '\0' 结尾，解析器需要 C 字符串
   const Type* ty;
-  auto s = parse_type(texpStr.c_str(), ty);
+  std::string cstr(texpStr.str());
+  auto s = parse_type(cstr.c_str(), ty);
   ASSERT(s && *s == '\0');
   mTyMap.emplace(texpStr, ty);
   return ty;
@@ -110,12 +199,7 @@ Json2Asg::expr(const llvm::json::Object& jobj)
   ASSERT(cateVal);
   auto cate = cateVal->getAsString();
   ASSERT(cate);
-  if (cate == "lvalue")
-    ret->cate = Expr::Cate::kLValue;
-  else if (cate == "prvalue")
-    ret->cate = Expr::Cate::kRValue;
-  else
-    ABORT();
+  ret->cate = value_category(*cate);
 
   return ret;
 }
@@ -175,15 +259,7 @@ Json2Asg::unary_expr(const llvm::json::Object& jobj)
 
   auto opCode = jobj.getString("opcode");
   ASSERT(opCode);
-  if (opCode == "-") {
-    unaryExpr->op = UnaryExpr::Op::kNeg;
-  } else if (opCode == "!") {
-    unaryExpr->op = UnaryExpr::Op::kNot;
-  } else if (opCode == "+") {
-    unaryExpr->op = UnaryExpr::Op::kPos;
-  } else {
-    ABORT();
-  }
+  unaryExpr->op = unary_op(*opCode);
 
   auto inner = jobj.getArray("inner");
   ASSERT(inner);
@@ -207,38 +283,7 @@ Json2Asg::binary_expr(const llvm::json::Object& jobj)
   else {
     auto opCode = jobj.getString("opcode");
     ASSERT(opCode);
-
-    if (opCode == "*")
-      binaryExpr->op = BinaryExpr::Op::kMul;
-    else if (opCode == "/")
-      binaryExpr->op = BinaryExpr::Op::kDiv;
-    else if (opCode == "%")
-      binaryExpr->op = BinaryExpr::Op::kMod;
-    else if (opCode == "+")
-      binaryExpr->op = BinaryExpr::Op::kAdd;
-    else if (opCode == "-")
-      binaryExpr->op = BinaryExpr::Op::kSub;
-    else if (opCode == ">")
-      binaryExpr->op = BinaryExpr::Op::kGt;
-    else if (opCode == "<")
-      binaryExpr->op = BinaryExpr::Op::kLt;
-    else if (opCode == ">=")
-      binaryExpr->op = BinaryExpr::Op::kGe;
-    else if (opCode == "<=")
-      binaryExpr->op = BinaryExpr::Op::kLe;
-    else if (opCode == "==")
-      binaryExpr->op = BinaryExpr::Op::kEq;
-    else if (opCode == "!=")
-      binaryExpr->op = BinaryExpr::Op::kNe;
-    else if (opCode == "&&")
-      binaryExpr->op = BinaryExpr::Op::kAnd;
-    else if (opCode == "||")
-      binaryExpr->op = BinaryExpr::Op::kOr;
-    else if (opCode == "=")
-      binaryExpr->op = BinaryExpr::Op::kAssign;
-    else {
-      ABORT();
-    }
+    binaryExpr->op = binary_op(*opCode);
   }
 
   auto inner = jobj.getArray("inner");
@@ -308,15 +353,7 @@ Json2Asg::implicit_cast_expr(const llvm::json::Object& jobj)
 
   auto castKind = jobj.getString("castKind");
   ASSERT(castKind);
-
-  if (castKind == "LValueToRValue")
-    implicitCastExpr->kind = ImplicitCastExpr::kLValueToRValue;
-  else if (castKind == "ArrayToPointerDecay")
-    implicitCastExpr->kind = ImplicitCastExpr::kArrayToPointerDecay;
-  else if (castKind == "FunctionToPointerDecay")
-    implicitCastExpr->kind = ImplicitCastExpr::kFunctionToPointerDecay;
-  else
-    ABORT();
+  implicitCastExpr->kind = cast_kind(*castKind);
 
   auto inner = jobj.getArray("inner");
   ASSERT(inner);
@@ -358,7 +395,7 @@ Json2Asg::var_decl(const llvm::json::Object& jobj)
 
   auto name = jobj.getString("name");
   ASSERT(name);
-  varDecl->name = name->str();
+  varDecl->name = std::string_view(*name);
 
   varDecl->type = getty(jobj);
 
@@ -380,7 +417,7 @@ Json2Asg::function_decl(const llvm::json::Object& jobj)
   auto funcDecl = make<FunctionDecl>(jobj_id(jobj));
 
   auto name = jobj.getString("name");
-  funcDecl->name = name->str();
+  funcDecl->name = std::string_view(*name);
 
   funcDecl->type = getty(jobj);
 
@@ -570,6 +607,385 @@ Json2Asg::expr_stmt(const llvm::json::Object& jobj)
   return exprStmt;
 }
 
+//==============================================================================
+// 流式读取
+//==============================================================================
+
+TranslationUnit*
+Json2Asg::operator()(JsonReader& reader)
+{
+  mReader = &reader;
+  auto obj = node();
+  mReader = nullptr;
+
+  if (!reader.end())
+    return nullptr;
+  ASSERT(obj && obj->kind<Kind>() == Kind::kTranslationUnit);
+  return obj->scst<TranslationUnit>();
+}
+
+Obj*
+Json2Asg::node()
+{
+  auto& reader = *mReader;
+  if (!reader.object_begin())
+    return nullptr;
+
+  Fields f;
+  Obj* ret = nullptr;
+  bool begun = false, hasInner = false;
+  llvm::SmallVector<Obj*, 4> inner, filler;
+
+  for (std::string_view key; reader.key(key);) {
+    if (key != "inner" && key != "array_filler") {
+      field(key, f);
+      continue;
+    }
+
+    if (!begun) {
+      begun = true;
+      ret = node_begin(f);
+    }
+    if (!ret) {
+      // 被忽略的结点，子树整个跳过
+      reader.skip();
+      continue;
+    }
+
+    // 与 DOM 的读法一致，InitListExpr 只在没有 inner 时才用 array_filler
+    auto& subs = key == "inner" ? inner : filler;
+    hasInner |= key == "inner";
+    reader.array_begin();
+    while (reader.element())
+      if (auto p = node())
+        subs.push_back(p);
+  }
+
+  if (reader.failed())
+    return nullptr;
+  if (!begun)
+    ret = node_begin(f);
+  if (ret)
+    node_end(ret, f, hasInner || filler.empty() ? inner : filler);
+  return ret;
+}
+
+void
+Json2Asg::field(std::string_view key, Fields& f)
+{
+  auto& reader = *mReader;
+
+  // 读取失败时字符串为空，交给 node() 返回 nullptr，而不是在这里断言
+  if (key == "id") {
+    auto id = reader.string();
+    if (!reader.failed())
+      f.mId = parse_id(id);
+  }
+
+  else if (key == "kind")
+    f.mKind = reader.string();
+
+  else if (key == "name")
+    f.mName = reader.string();
+
+  else if (key == "valueCategory")
+    f.mValueCategory = reader.string();
+
+  else if (key == "opcode")
+    f.mOpcode = reader.string();
+
+  else if (key == "castKind")
+    f.mCastKind = reader.string();
+
+  else if (key == "value" && reader.peek() == '"')
+    f.mValue = reader.string();
+
+  else if (key == "isImplicit")
+    f.mImplicit = reader.boolean();
+
+  else if (key == "type") {
+    reader.object_begin();
+    for (std::string_view key; reader.key(key);) {
+      if (key == "qualType")
+        f.mType = reader.string();
+      else
+        reader.skip();
+    }
+  }
+
+  else if (key == "referencedDecl") {
+    reader.object_begin();
+    for (std::string_view key; reader.key(key);) {
+      if (key == "id") {
+        auto id = reader.string();
+        if (!reader.failed())
+          f.mRefId = parse_id(id);
+      } else
+        reader.skip();
+    }
+  }
+
+  // loc、range 等
+  else
+    reader.skip();
+}
+
+Obj*
+Json2Asg::node_begin(const Fields& f)
+{
+  auto& kind = f.mKind;
+  ASSERT(!kind.empty());
+
+  if (kind == "TranslationUnitDecl")
+    return make<TranslationUnit>();
+
+  // 声明
+
+  if (kind == "VarDecl" || kind == "ParmVarDecl")
+    return make<VarDecl>(f.mId);
+
+  if (kind == "FunctionDecl") {
+    if (f.mImplicit)
+      return nullptr;
+    mCurFunc = make<FunctionDecl>(f.mId);
+    return mCurFunc;
+  }
+
+  if (kind == "TypedefDecl")
+    return nullptr;
+
+  // 表达式
+
+  if (kind == "IntegerLiteral")
+    return make<IntegerLiteral>();
+
+  if (kind == "BinaryOperator" || kind == "ArraySubscriptExpr")
+    return make<BinaryExpr>();
+
+  if (kind == "UnaryOperator")
+    return make<UnaryExpr>();
+
+  if (kind == "DeclRefExpr")
+    return make<DeclRefExpr>();
+
+  if (kind == "ImplicitCastExpr")
+    return make<ImplicitCastExpr>();
+
+  if (kind == "ParenExpr")
+    return make<ParenExpr>();
+
+  if (kind == "InitListExpr")
+    return make<InitListExpr>();
+
+  if (kind == "ImplicitValueInitExpr")
+    return make<ImplicitInitExpr>();
+
+  if (kind == "CallExpr")
+    return make<CallExpr>();
+
+  // 语句
+
+  if (kind == "CompoundStmt")
+    return make<CompoundStmt>();
+
+  if (kind == "DeclStmt")
+    return make<DeclStmt>();
+
+  if (kind == "NullStmt")
+    return make<NullStmt>();
+
+  if (kind == "ReturnStmt") {
+    auto ret = make<ReturnStmt>();
+    ret->func = mCurFunc;
+    return ret;
+  }
+
+  if (kind == "IfStmt")
+    return make<IfStmt>();
+
+  if (kind == "WhileStmt") {
+    auto ret = make<WhileStmt>();
+    mCurLoop = ret;
+    return ret;
+  }
+
+  if (kind == "BreakStmt") {
+    auto ret = make<BreakStmt>();
+    ret->loop = mCurLoop;
+    return ret;
+  }
+
+  if (kind == "ContinueStmt") {
+    auto ret = make<ContinueStmt>();
+    ret->loop = mCurLoop;
+    return ret;
+  }
+
+  ABORT();
+}
+
+void
+Json2Asg::node_end(Obj* obj, const Fields& f, llvm::ArrayRef<Obj*> inner)
+{
+  auto sub_expr = [&](std::size_t i) {
+    ASSERT(i < inner.size());
+    auto ret = inner[i]->dcst<Expr>();
+    ASSERT(ret);
+    return ret;
+  };
+
+  // 出现在语句位置上的表达式包装为 ExprStmt
+  auto sub_stmt = [&](std::size_t i) -> Stmt* {
+    ASSERT(i < inner.size());
+    if (auto p = inner[i]->dcst<Expr>()) {
+      auto ret = make<ExprStmt>();
+      ret->expr = p;
+      return ret;
+    }
+    auto ret = inner[i]->dcst<Stmt>();
+    ASSERT(ret);
+    return ret;
+  };
+
+  auto sub_decl = [&](std::size_t i) {
+    auto ret = inner[i]->dcst<Decl>();
+    ASSERT(ret);
+    return ret;
+  };
+
+  if (auto p = obj->dcst<Expr>()) {
+    p->type = getty(f.mType);
+    p->cate = value_category(f.mValueCategory);
+  } else if (auto p = obj->dcst<Decl>()) {
+    p->name = f.mName;
+    p->type = getty(f.mType);
+  }
+
+  switch (obj->kind<Kind>()) {
+    case Kind::kTranslationUnit: {
+      auto p = obj->scst<TranslationUnit>();
+      for (std::size_t i = 0; i < inner.size(); ++i)
+        p->decls.push_back(sub_decl(i));
+      break;
+    }
+
+    case Kind::kVarDecl:
+      obj->scst<VarDecl>()->init = inner.empty() ? nullptr : sub_expr(0);
+      break;
+
+    case Kind::kFunctionDecl: {
+      auto p = obj->scst<FunctionDecl>();
+      for (auto sub : inner) {
+        if (auto q = sub->dcst<VarDecl>())
+          p->params.push_back(q);
+        else if (auto q = sub->dcst<CompoundStmt>()) {
+          ASSERT(p->body == nullptr);
+          p->body = q;
+        } else
+          ABORT();
+      }
+      break;
+    }
+
+    case Kind::kIntegerLiteral: {
+      auto p = obj->scst<IntegerLiteral>();
+      auto end = f.mValue.data() + f.mValue.size();
+      auto [ptr, ec] = std::from_chars(f.mValue.data(), end, p->val);
+      ASSERT(!f.mValue.empty() && ec == std::errc() && ptr == end);
+      break;
+    }
+
+    case Kind::kDeclRefExpr: {
+      auto iter = mIdMap.find(f.mRefId);
+      ASSERT(iter != mIdMap.end());
+      auto decl = iter->second->dcst<Decl>();
+      ASSERT(decl);
+      obj->scst<DeclRefExpr>()->decl = decl;
+      break;
+    }
+
+    case Kind::kParenExpr:
+      obj->scst<ParenExpr>()->sub = sub_expr(0);
+      break;
+
+    case Kind::kUnaryExpr: {
+      auto p = obj->scst<UnaryExpr>();
+      p->op = unary_op(f.mOpcode);
+      p->sub = sub_expr(0);
+      break;
+    }
+
+    case Kind::kBinaryExpr: {
+      auto p = obj->scst<BinaryExpr>();
+      p->op = f.mKind == "ArraySubscriptExpr" ? BinaryExpr::Op::kIndex
+                                              : binary_op(f.mOpcode);
+      p->lft = sub_expr(0);
+      p->rht = sub_expr(1);
+      break;
+    }
+
+    case Kind::kCallExpr: {
+      auto p = obj->scst<CallExpr>();
+      p->head = sub_expr(0);
+      for (std::size_t i = 1; i < inner.size(); ++i)
+        p->args.push_back(sub_expr(i));
+      break;
+    }
+
+    case Kind::kInitListExpr: {
+      auto p = obj->scst<InitListExpr>();
+      for (std::size_t i = 0; i < inner.size(); ++i)
+        p->list.push_back(sub_expr(i));
+      break;
+    }
+
+    case Kind::kImplicitCastExpr: {
+      auto p = obj->scst<ImplicitCastExpr>();
+      p->kind = cast_kind(f.mCastKind);
+      p->sub = sub_expr(0);
+      break;
+    }
+
+    case Kind::kCompoundStmt: {
+      auto p = obj->scst<CompoundStmt>();
+      for (std::size_t i = 0; i < inner.size(); ++i)
+        p->subs.push_back(sub_stmt(i));
+      break;
+    }
+
+    case Kind::kDeclStmt: {
+      auto p = obj->scst<DeclStmt>();
+      for (std::size_t i = 0; i < inner.size(); ++i)
+        p->decls.push_back(sub_decl(i));
+      break;
+    }
+
+    case Kind::kReturnStmt:
+      if (!inner.empty())
+        obj->scst<ReturnStmt>()->expr = sub_expr(0);
+      break;
+
+    case Kind::kIfStmt: {
+      auto p = obj->scst<IfStmt>();
+      p->cond = sub_expr(0);
+      p->then = sub_stmt(1);
+      if (inner.size() == 3)
+        p->else_ = sub_stmt(2);
+      break;
+    }
+
+    case Kind::kWhileStmt: {
+      auto p = obj->scst<WhileStmt>();
+      p->cond = sub_expr(0);
+      p->body = sub_stmt(1);
+      break;
+    }
+
+    default:
+      break;
+  }
+}
+
 // ========================================================================== //
 // 类型字符串解析
 // ========================================================================== //
@@ -1,7 +1,9 @@
 #pragma once
 
+#include "JsonReader.hpp"
 #include "asg.hpp"
 #include <any>
+#include <llvm/ADT/ArrayRef.h>
 #include <llvm/Support/JSON.h>
 #include <regex>
 #include <unordered_map>
@@ -18,9 +20,18 @@ public:
 
   asg::TranslationUnit* operator()(const llvm::json::Value& jval);
 
+  /**
+   * @brief 从拉取式读取器中边读边构造 ASG，不建立 JSON 的 DOM
+   *
+   * 结点在读到它的 "inner" 时创建，创建所需的 id、kind 和 isImplicit 在 clang
+   * 的输出中都排在 "inner" 之前。被忽略的结点（如隐式的内建类型定义）的子树
+   * 以及 loc、range 等用不到的字段直接跳过。输入有语法错误时返回 nullptr。
+   */
+  asg::TranslationUnit* operator()(JsonReader& reader);
+
 private:
   std::unordered_map<std::size_t, Obj*> mIdMap;
-  std::unordered_map<std::string, const asg::Type*> mTyMap;
+  std::unordered_map<Atom, const asg::Type*> mTyMap; ///< 类型字符串的缓存
 
   /**
    * 在遍历函数体时指向当前的函数声明，从而给函数体内返回语句的 ReturnStmt
@@ -55,6 +66,9 @@ private:
 
   const asg::Type* getty(const llvm::json::Object& jobj);
 
+  /// 解析类型字符串 \p qualType ，结果按字符串缓存
+  const asg::Type* getty(std::string_view qualType);
+
   //============================================================================
   // 表达式
   //============================================================================
@@ -113,6 +127,39 @@ private:
 
   asg::FunctionDecl* function_decl(const llvm::json::Object& jobj);
 
+  //============================================================================
+  // 流式读取
+  //============================================================================
+
+  JsonReader* mReader{ nullptr };
+
+  /// 一个对象中用到的字段，字符串都指向输入缓冲区
+  struct Fields
+  {
+    std::string_view mKind;
+    std::string_view mName;
+    std::string_view mType; ///< type.qualType
+    std::string_view mValueCategory;
+    std::string_view mOpcode;
+    std::string_view mCastKind;
+    std::string_view mValue;
+    std::size_t mId{ 0 };
+    std::size_t mRefId{ 0 }; ///< referencedDecl.id
+    bool mImplicit{ false };
+  };
+
+  /// 读取一个对象，返回构造出的结点，被忽略的对象返回 nullptr
+  Obj* node();
+
+  /// 读取键 \p key 的值，用不到的值直接跳过
+  void field(std::string_view key, Fields& f);
+
+  /// 按 "inner" 之前读到的字段创建结点，被忽略的结点返回 nullptr
+  Obj* node_begin(const Fields& f);
+
+  /// 对象读完后填写结点的其余字段和子结点
+  void node_end(Obj* obj, const Fields& f, llvm::ArrayRef<Obj*> inner);
+
 private:
   /**
    * @brief 尝试解析以 \p s 为起始的字符串，将语义值存入 \p v 。
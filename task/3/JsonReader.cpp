@@ -0,0 +1,345 @@
+#include "JsonReader.hpp"
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+int
+hex_digit(char c)
+{
+  if ('0' <= c && c <= '9')
+    return c - '0';
+  if ('a' <= c && c <= 'f')
+    return c - 'a' + 10;
+  if ('A' <= c && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+/// 把码点 \p cp 以 UTF-8 写到 \p out
+void
+put_utf8(char*& out, std::uint32_t cp)
+{
+  if (cp < 0x80) {
+    *out++ = cp;
+  } else if (cp < 0x800) {
+    *out++ = 0xC0 | (cp >> 6);
+    *out++ = 0x80 | (cp & 0x3F);
+  } else if (cp < 0x10000) {
+    *out++ = 0xE0 | (cp >> 12);
+    *out++ = 0x80 | ((cp >> 6) & 0x3F);
+    *out++ = 0x80 | (cp & 0x3F);
+  } else {
+    *out++ = 0xF0 | (cp >> 18);
+    *out++ = 0x80 | ((cp >> 12) & 0x3F);
+    *out++ = 0x80 | ((cp >> 6) & 0x3F);
+    *out++ = 0x80 | (cp & 0x3F);
+  }
+}
+
+} // namespace
+
+void
+JsonReader::fail()
+{
+  if (!mError)
+    mError = mPos;
+  mPos = mEnd;
+}
+
+char
+JsonReader::space()
+{
+  while (mPos != mEnd &&
+         (*mPos == ' ' || *mPos == '\n' || *mPos == '\r' || *mPos == '\t'))
+    ++mPos;
+  return mPos == mEnd ? '\0' : *mPos;
+}
+
+char
+JsonReader::peek()
+{
+  return space();
+}
+
+bool
+JsonReader::object_begin()
+{
+  if (space() != '{') {
+    fail();
+    return false;
+  }
+  ++mPos;
+  mFirst = true;
+  return true;
+}
+
+bool
+JsonReader::array_begin()
+{
+  if (space() != '[') {
+    fail();
+    return false;
+  }
+  ++mPos;
+  mFirst = true;
+  return true;
+}
+
+bool
+JsonReader::next(char close)
+{
+  auto c = space();
+  if (c == close) {
+    ++mPos;
+    mFirst = false;
+    return false;
+  }
+  if (!mFirst) {
+    if (c != ',') {
+      fail();
+      return false;
+    }
+    ++mPos;
+  }
+  mFirst = false;
+  return true;
+}
+
+bool
+JsonReader::key(std::string_view& key)
+{
+  if (!next('}'))
+    return false;
+  if (space() != '"') {
+    fail();
+    return false;
+  }
+  key = string();
+  if (space() != ':') {
+    fail();
+    return false;
+  }
+  ++mPos;
+  return true;
+}
+
+bool
+JsonReader::element()
+{
+  if (!next(']'))
+    return false;
+  // 空数组之外，紧跟在逗号后的 ']' 是语法错误
+  if (space() == ']') {
+    fail();
+    return false;
+  }
+  return true;
+}
+
+std::string_view
+JsonReader::string()
+{
+  if (space() != '"') {
+    fail();
+    return {};
+  }
+  auto begin = ++mPos;
+
+  // 先不写缓冲区地找到结尾或第一个转义序列
+  while (mPos != mEnd && *mPos != '"' && *mPos != '\\') {
+    if (static_cast<unsigned char>(*mPos) < 0x20) {
+      fail();
+      return {};
+    }
+    ++mPos;
+  }
+  auto out = mPos;
+
+  while (mPos != mEnd) {
+    auto c = *mPos++;
+    if (c == '"')
+      return std::string_view(begin, out - begin);
+    if (c == '\\') {
+      if (!escape(out))
+        return {};
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      --mPos;
+      break;
+    } else {
+      *out++ = c;
+    }
+  }
+  fail();
+  return {};
+}
+
+bool
+JsonReader::escape(char*& out)
+{
+  if (mPos == mEnd) {
+    fail();
+    return false;
+  }
+  switch (auto c = *mPos++) {
+    case '"':
+    case '\\':
+    case '/':
+      *out++ = c;
+      return true;
+    case 'b':
+      *out++ = '\b';
+      return true;
+    case 'f':
+      *out++ = '\f';
+      return true;
+    case 'n':
+      *out++ = '\n';
+      return true;
+    case 'r':
+      *out++ = '\r';
+      return true;
+    case 't':
+      *out++ = '\t';
+      return true;
+    case 'u':
+      break;
+    default:
+      --mPos;
+      fail();
+      return false;
+  }
+
+  auto hex4 = [&](std::uint32_t& cp) {
+    if (mEnd - mPos < 4)
+      return false;
+    cp = 0;
+    for (int i = 0; i < 4; ++i) {
+      auto d = hex_digit(mPos[i]);
+      if (d < 0)
+        return false;
+      cp = cp * 16 + d;
+    }
+    mPos += 4;
+    return true;
+  };
+
+  std::uint32_t cp;
+  if (!hex4(cp)) {
+    fail();
+    return false;
+  }
+
+  // 代理对由两个 \u 组成，落单的代理按 U+FFFD 处理，与 llvm::json 一致
+  if (0xD800 <= cp && cp < 0xDC00 && mEnd - mPos >= 6 && mPos[0] == '\\' &&
+      mPos[1] == 'u') {
+    auto save = mPos;
+    mPos += 2;
+    std::uint32_t low;
+    if (hex4(low) && 0xDC00 <= low && low < 0xE000)
+      cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+    else
+      mPos = save, cp = 0xFFFD;
+  } else if (0xD800 <= cp && cp < 0xE000) {
+    cp = 0xFFFD;
+  }
+
+  put_utf8(out, cp);
+  return true;
+}
+
+bool
+JsonReader::literal(std::string_view word)
+{
+  if (std::size_t(mEnd - mPos) < word.size() ||
+      std::memcmp(mPos, word.data(), word.size())) {
+    fail();
+    return false;
+  }
+  mPos += word.size();
+  return true;
+}
+
+bool
+JsonReader::boolean()
+{
+  switch (space()) {
+    case 't':
+      return literal("true");
+    case 'f':
+      literal("false");
+      return false;
+    default:
+      fail();
+      return false;
+  }
+}
+
+void
+JsonReader::skip()
+{
+  switch (space()) {
+    case '"':
+      // 只找结尾的引号，不解码
+      for (++mPos; mPos != mEnd && *mPos != '"'; ++mPos)
+        if (*mPos == '\\' && ++mPos == mEnd)
+          break;
+      if (mPos == mEnd)
+        return fail();
+      ++mPos;
+      break;
+
+    case '{':
+    case '[': {
+      // 只数括号的层数，嵌套再深也不递归
+      std::size_t depth = 0;
+      do {
+        auto c = space();
+        if (c == '"') {
+          skip();
+          continue;
+        }
+        if (c == '\0')
+          return fail();
+        if (c == '{' || c == '[')
+          ++depth;
+        else if (c == '}' || c == ']')
+          --depth;
+        ++mPos;
+      } while (depth != 0);
+      break;
+    }
+
+    case 't':
+      literal("true");
+      break;
+
+    case 'f':
+      literal("false");
+      break;
+
+    case 'n':
+      literal("null");
+      break;
+
+    default: {
+      // 数字
+      auto begin = mPos;
+      while (mPos != mEnd && (('0' <= *mPos && *mPos <= '9') || *mPos == '-' ||
+                              *mPos == '+' || *mPos == '.' || *mPos == 'e' ||
+                              *mPos == 'E'))
+        ++mPos;
+      if (mPos == begin)
+        fail();
+    }
+  }
+  mFirst = false;
+}
+
+bool
+JsonReader::end()
+{
+  if (space() != '\0')
+    fail();
+  return !failed();
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+/**
+ * @brief 拉取式的 JSON 读取器
+ *
+ * 调用者按预期的结构逐个拉取值，不需要的值用 skip() 整体跳过，整个过程
+ * 不构造任何 DOM 结点，内存占用只与调用者的递归深度有关。
+ *
+ * 字符串在输入缓冲区中原地解码转义序列（解码后不会变长），返回的
+ * string_view 直接指向缓冲区，因此缓冲区必须可写，并且在使用这些字符串
+ * 期间保持有效。没有转义序列的字符串不会写缓冲区。
+ *
+ * 遇到语法错误时记录出错的位置，此后的拉取都表现为到达容器末尾或得到空值，
+ * 调用者可以照常结束遍历，最后再用 failed() 检查。
+ */
+class JsonReader
+{
+public:
+  JsonReader(char* data, std::size_t size)
+    : mBegin(data)
+    , mPos(data)
+    , mEnd(data + size)
+  {
+  }
+
+  /// 下一个值的首字符，不消耗输入，到达末尾时返回 '\0'
+  char peek();
+
+  /// 进入一个对象，当前值不是对象时出错
+  bool object_begin();
+
+  /// 读取对象的下一个键，遇到对象的结尾时返回 false
+  bool key(std::string_view& key);
+
+  /// 进入一个数组，当前值不是数组时出错
+  bool array_begin();
+
+  /// 数组中是否还有下一个元素，遇到数组的结尾时返回 false
+  bool element();
+
+  std::string_view string();
+
+  bool boolean();
+
+  /// 跳过当前值。被跳过的对象和数组只检查括号的层数和字符串的边界。
+  void skip();
+
+  /// 确认输入中只剩下空白
+  bool end();
+
+  bool failed() const { return mError != nullptr; }
+
+  /// 出错位置在输入中的偏移
+  std::size_t error() const { return mError - mBegin; }
+
+private:
+  char* mBegin;
+  char* mPos;
+  char* mEnd;
+  char* mError{ nullptr };
+
+  /// 当前容器中还没有读过任何元素，此时不需要逗号
+  bool mFirst{ false };
+
+  void fail();
+
+  /// 跳过空白，返回下一个字符，到达末尾时返回 '\0'
+  char space();
+
+  /// 跳过容器中元素之间的逗号，遇到 \p close 时消耗它并返回 false
+  bool next(char close);
+
+  bool literal(std::string_view word);
+
+  /// 解码从 \p out 开始的转义序列，\p mPos 指向反斜杠之后
+  bool escape(char*& out);
+};
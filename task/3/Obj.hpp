@@ -1,9 +1,13 @@
 #pragma once
 
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <memory>
+#include <new>
+#include <type_traits>
 #include <vector>
 
 /// 错误断言，打印文件和行号，方便定位问题。
@@ -20,6 +24,7 @@
 struct alignas(ptrdiff_t) Obj
 {
   struct Mgr;
+  struct Arena;
   struct Walked;
 
   using Mark = void (*)(Obj* obj);
@@ -27,16 +32,18 @@ struct alignas(ptrdiff_t) Obj
   Obj() = default;
   virtual ~Obj() = default;
 
+  /// 向下转型，失败时返回空指针。若 T 提供了 `static bool classof(const Obj*)`
+  /// 就用它检查种类标签，否则退回 dynamic_cast。
   template<typename T>
   T* dcst()
   {
-    return dynamic_cast<T*>(this);
+    return cast_to<T>(this);
   }
 
   template<typename T>
   T* dcst() const
   {
-    return dynamic_cast<T*>(this);
+    return cast_to<T>(this);
   }
 
   template<typename T>
@@ -77,7 +84,39 @@ struct alignas(ptrdiff_t) Obj
     return reinterpret_cast<T*>(any);
   }
 
+  /// 种类标签，由子类在构造时写入，含义由子类自行约定
+  template<typename K>
+  K kind() const
+  {
+    return static_cast<K>(__kind__);
+  }
+
+protected:
+  explicit Obj(std::uint8_t kind)
+    : __kind__(kind)
+  {
+  }
+
 private:
+  template<typename T, typename = void>
+  struct has_classof : std::false_type
+  {};
+
+  template<typename T>
+  struct has_classof<T, std::void_t<decltype(&std::remove_cv_t<T>::classof)>>
+    : std::true_type
+  {};
+
+  /// 遍历器中不少地方会对可能为空的指针调用 dcst，因此这里容忍空指针。
+  template<typename T, typename P>
+  static T* cast_to(P* obj)
+  {
+    if constexpr (has_classof<T>::value)
+      return obj && T::classof(obj) ? static_cast<T*>(obj) : nullptr;
+    else
+      return dynamic_cast<T*>(obj);
+  }
+
   Obj(Obj* next)
     : __next__(next)
   {
@@ -88,34 +127,132 @@ private:
   void operator=(const Obj&) = delete;
   void operator=(Obj&&) = delete;
 
-  Obj* __next__{ nullptr }; /// 环形指针，低3位由于对齐要求必为0，用作标记
+  /// 环形指针，低3位由于对齐要求必为0，用作标记：
+  /// 0b1 为垃圾回收标记，0b10 为遍历标记，0b100 表示对象分配在竞技场中。
+  /// 标记属于持有该指针的对象本身，而不是指针指向的对象。
+  Obj* __next__{ nullptr };
+
+  std::uint8_t __kind__{ 0 }; /// 种类标签，0 表示未设置
 
   virtual void __mark__(Mark mark) = 0; /// 标记对象
 };
 
+/**
+ * @brief 竞技场分配器
+ *
+ * 按尺寸分级（size class）管理内存：每一级从对齐的大块（slab）中顺序切分出
+ * 等长的格子，大块头部记录所属的级别，因此释放格子时只需把地址按块大小对齐
+ * 就能找到级别，把格子挂回该级的空闲链表以便复用。所有大块在竞技场析构时整
+ * 体释放，其间不会向系统归还内存。
+ */
+struct Obj::Arena
+{
+  static constexpr std::size_t kGrain = alignof(std::max_align_t); ///< 级差
+  static constexpr std::size_t kMaxCell = 256; ///< 最大格子，更大的对象不管
+  static constexpr std::size_t kClasses = kMaxCell / kGrain;
+  static constexpr std::size_t kSlabSize = std::size_t(64) << 10;
+
+  Arena() = default;
+  Arena(const Arena&) = delete;
+  void operator=(const Arena&) = delete;
+  ~Arena();
+
+  void* alloc(std::size_t size)
+  {
+    auto cls = (size - 1) / kGrain;
+    if (auto cell = mFree[cls]) {
+      mFree[cls] = *static_cast<void**>(cell);
+      return cell;
+    }
+    if (mTop[cls] == mEnd[cls])
+      refill(cls);
+    auto cell = mTop[cls];
+    mTop[cls] += (cls + 1) * kGrain;
+    return cell;
+  }
+
+  /// 归还 alloc 得到的格子，调用前格子上的对象必须已经析构
+  void free(void* cell);
+
+  std::size_t mSlabCount{ 0 }; ///< 已申请的大块数
+
+private:
+  struct Slab
+  {
+    Slab* mNext;
+    std::size_t mClass;
+  };
+
+  static constexpr std::size_t kHeadSize =
+    (sizeof(Slab) + kGrain - 1) / kGrain * kGrain;
+
+  Slab* mSlabs{ nullptr };
+  void* mFree[kClasses]{};
+  char* mTop[kClasses]{};
+  char* mEnd[kClasses]{};
+
+  void refill(std::size_t cls);
+};
+
 /// 对象管理器
 struct Obj::Mgr : Obj
 {
-  Mgr()
+  /// 内存分配方式
+  enum struct Alloc : std::uint8_t
+  {
+    kHeap,  ///< 每个对象单独 new，回收时单独 delete
+    kArena, ///< 对象从竞技场中分配，管理器析构时整体释放，gc 变为可选
+  };
+
+  explicit Mgr(Alloc alloc = Alloc::kHeap)
     : Obj(this)
   {
+    if (alloc == Alloc::kArena)
+      mArena = std::make_unique<Arena>();
   }
 
+  /// 析构所有仍然存活的对象
+  ~Mgr() override;
+
   template<typename T,
            typename... Args,
            typename = std::enable_if_t<std::is_convertible_v<T*, Obj*>>>
   T* make(Args... args)
   {
-    auto obj = new T(args...);
-    obj->__next__ = __next__, __next__ = obj;
+    T* obj;
+    if (mArena && sizeof(T) <= Arena::kMaxCell &&
+        alignof(T) <= Arena::kGrain) {
+      obj = new (mArena->alloc(sizeof(T))) T(args...);
+      obj->__next__ = gc_next(this);
+      reinterpret_cast<uintptr_t&>(obj->__next__) |= uintptr_t(0b100);
+    } else {
+      obj = new T(args...);
+      obj->__next__ = gc_next(this);
+    }
+    __next__ = obj;
     return obj;
   }
 
   Obj* mRoot{ nullptr }; /// 根对象
 
-  /// 垃圾回收，使用标记-清扫算法
+  /// 标记栈的容量上限，超出时退化为重新扫描世界环，而不会无限增长
+  std::size_t mMarkStackLimit{ std::size_t(1) << 16 };
+
+  /// 一次垃圾回收的统计信息
+  struct GcStats
+  {
+    std::size_t mLive{ 0 };    ///< 回收后存活的对象数
+    std::size_t mFreed{ 0 };   ///< 本次释放的对象数
+    std::size_t mRescans{ 0 }; ///< 标记栈溢出导致的世界环重扫次数
+    double mMarkMs{ 0 }, mSweepMs{ 0 };
+
+    /// 以 \p tag 为前缀，将统计信息打印为一行
+    void print(std::FILE* out, const char* tag) const;
+  };
+
+  /// 垃圾回收，使用标记-清扫算法，返回本次回收的统计信息
   /// @warning 垃圾回收时调用栈上不能有对象的引用！
-  void gc();
+  GcStats gc();
 
 private:
   void __mark__(Mark mark) override;
@@ -135,7 +272,28 @@ private:
     reinterpret_cast<uintptr_t&>(obj->__next__) |= uintptr_t(0b1);
   }
 
-  static void gc_mark_dfs(Obj* obj);
+  static Obj* gc_next(const Obj* obj)
+  {
+    return reinterpret_cast<Obj*>(reinterpret_cast<uintptr_t>(obj->__next__) &
+                                  ~uintptr_t(0b111));
+  }
+
+  /// 标记回调只能是普通函数指针，因此用它指明正在标记的管理器
+  static Mgr* sMarking;
+
+  /// 标记对象并将其压入标记栈，等待扫描它引用的对象
+  static void gc_mark_push(Obj* obj);
+
+  /// 弹出并扫描标记栈中的对象，直到栈空
+  void gc_mark_drain();
+
+  std::vector<Obj*> mMarkStack; ///< 显式的标记栈，在多次回收间复用
+  bool mMarkOverflow{ false };  ///< 本轮标记中是否有对象因栈满而未被扫描
+
+  /// 析构对象并释放其内存
+  void gc_free(Obj* obj);
+
+  std::unique_ptr<Arena> mArena; ///< 为空时使用 Alloc::kHeap
 };
 
 /// 检查循环引用，防止无限递归。
@@ -1,54 +1,111 @@
 #include "EmitIR.hpp"
 #include "Json2Asg.hpp"
 #include "asg.hpp"
+#include <chrono>
 #include <fstream>
 #include <iostream>
 #include <llvm/IR/Verifier.h>
+#include <llvm/Support/Format.h>
 #include <llvm/Support/MemoryBuffer.h>
+#include <sstream>
+#include <string>
+#include <vector>
 
+/// 编译一个单元，返回值即单文件模式下的进程退出码
 int
-main(int argc, char* argv[])
+compile(const char* inPath, const char* outPath, llvm::LLVMContext& ctx)
 {
-  if (argc != 3) {
-    std::cout << "Usage: " << argv[0] << " <input> <output>\n";
-    return -1;
-  }
-
-  auto inFileOrErr = llvm::MemoryBuffer::getFile(argv[1]);
+  // 读取器在缓冲区中原地解码字符串，因此以可写的方式读入
+  auto inFileOrErr = llvm::WritableMemoryBuffer::getFile(inPath);
   if (auto err = inFileOrErr.getError()) {
-    std::cout << "Error: unable to open input file: " << argv[1] << '\n';
+    std::cout << "Error: unable to open input file: " << inPath << '\n';
     return -2;
   }
   auto inFile = std::move(inFileOrErr.get());
   std::error_code ec;
-  llvm::StringRef outPath(argv[2]);
   llvm::raw_fd_ostream outFile(outPath, ec);
   if (ec) {
-    std::cout << "Error: unable to open output file: " << argv[2] << '\n';
+    std::cout << "Error: unable to open output file: " << outPath << '\n';
     return -3;
   }
 
-  auto json = llvm::json::parse(inFile->getBuffer());
-  if (!json) {
-    std::cout << "Error: unable to parse input file: " << argv[1] << '\n';
+  // 边读取 JSON 边转换为 ASG，不构造 JSON 的 DOM
+  Obj::Mgr mgr(Obj::Mgr::Alloc::kArena);
+  JsonReader reader(inFile->getBufferStart(), inFile->getBufferSize());
+  Json2Asg json2asg(mgr);
+  auto asg = json2asg(reader);
+  if (!asg) {
+    std::cout << "Error: unable to parse input file: " << inPath << '\n';
     return 1;
   }
-
-  // 读取 JSON，转换为 ASG
-  Obj::Mgr mgr;
-  Json2Asg json2asg(mgr);
-  auto asg = json2asg(json.get());
   mgr.mRoot = asg;
-  mgr.gc();
+  mgr.gc().print(stderr, "读取 ASG 后垃圾回收");
 
   // 从 ASG 发射到 LLVM IR
-  llvm::LLVMContext ctx;
   EmitIR emitIR(mgr, ctx);
   auto& mod = emitIR(asg);
-  mgr.gc();
+  mgr.gc().print(stderr, "发射 IR 后垃圾回收");
 
   // 先把 LLVM IR 写出到文件里，再检查合不合法
   mod.print(outFile, nullptr, false, true);
   if (llvm::verifyModule(mod, &llvm::outs()))
     return 3;
+  return 0;
+}
+
+int
+main(int argc, char* argv[])
+{
+  if (argc != 3) {
+    std::cout << "Usage: " << argv[0] << " <input> <output>\n"
+              << "       " << argv[0] << " --batch <manifest>\n";
+    return -1;
+  }
+
+  llvm::LLVMContext ctx;
+
+  if (std::string(argv[1]) != "--batch")
+    return compile(argv[1], argv[2], ctx);
+
+  // 批量模式：清单的每一行是一对“输入 输出”路径，空行和 # 开头的行忽略。
+  // 所有单元共用同一个 LLVMContext，每个单元仍有各自的对象管理器。
+  std::ifstream manifest(argv[2]);
+  if (!manifest) {
+    std::cout << "Error: unable to open manifest: " << argv[2] << '\n';
+    return -2;
+  }
+
+  std::vector<std::pair<std::string, std::string>> units;
+  for (std::string line; std::getline(manifest, line);) {
+    std::istringstream iss(line);
+    std::string in, out;
+    if (!(iss >> in) || in[0] == '#')
+      continue;
+    if (!(iss >> out)) {
+      std::cout << "Error: missing output path for " << in << '\n';
+      return -2;
+    }
+    units.emplace_back(std::move(in), std::move(out));
+  }
+
+  using Clock = std::chrono::steady_clock;
+  int failed = 0;
+  auto begin = Clock::now();
+  for (std::size_t i = 0; i < units.size(); ++i) {
+    auto& [in, out] = units[i];
+    auto start = Clock::now();
+    auto ret = compile(in.c_str(), out.c_str(), ctx);
+    std::chrono::duration<double, std::milli> ms = Clock::now() - start;
+    if (ret != 0)
+      ++failed;
+    llvm::errs() << "[" << i + 1 << "/" << units.size() << "] " << in
+                 << " -> " << out << "：返回 " << ret << "，用时 "
+                 << llvm::format("%.3f", ms.count()) << " ms\n";
+  }
+  std::chrono::duration<double, std::milli> total = Clock::now() - begin;
+  llvm::errs() << "共 " << units.size() << " 个单元，失败 " << failed
+               << " 个，总用时 " << llvm::format("%.3f", total.count())
+               << " ms\n";
+
+  return failed ? 1 : 0;
 }
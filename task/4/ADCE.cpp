@@ -0,0 +1,181 @@
+#include "ADCE.hpp"
+#include <llvm/Analysis/IteratedDominanceFrontier.h>
+#include <llvm/Analysis/PostDominators.h>
+#include <llvm/IR/CFG.h>
+
+using namespace llvm;
+
+namespace {
+
+/// 活性标记
+class Marker
+{
+public:
+  explicit Marker(PostDominatorTree& pdt)
+    : mPdt(pdt)
+  {
+  }
+
+  /// 从根出发标记到不动点
+  void mark(Function& func);
+
+  bool live(Instruction* inst) const { return mLiveInsts.count(inst); }
+
+private:
+  PostDominatorTree& mPdt;
+  SmallPtrSet<Instruction*, 32> mLiveInsts;
+  SmallPtrSet<BasicBlock*, 32> mLiveBlocks; ///< 控制流上活的块
+  SmallPtrSet<BasicBlock*, 32> mPhiBlocks;  ///< 已处理过活 PHI 的块
+  SmallVector<Instruction*, 128> mWork;
+  SmallPtrSet<BasicBlock*, 32> mNewLiveBlocks;
+
+  void mark_live(Instruction* inst);
+  void mark_block_live(BasicBlock* bb);
+};
+
+/// 指令本身必须保留：有副作用，或者是分支以外的终结指令
+bool
+is_root(Instruction* inst)
+{
+  if (inst->isTerminator())
+    return !isa<BranchInst>(inst) && !isa<SwitchInst>(inst);
+  return inst->mayHaveSideEffects();
+}
+
+void
+Marker::mark_live(Instruction* inst)
+{
+  if (!mLiveInsts.insert(inst).second)
+    return;
+  mWork.push_back(inst);
+
+  // 无条件跳转不做任何决定，它活着并不要求所在块被执行
+  auto br = dyn_cast<BranchInst>(inst);
+  if (!br || br->isConditional())
+    mark_block_live(inst->getParent());
+}
+
+void
+Marker::mark_block_live(BasicBlock* bb)
+{
+  if (mLiveBlocks.insert(bb).second)
+    mNewLiveBlocks.insert(bb);
+}
+
+void
+Marker::mark(Function& func)
+{
+  for (auto& bb : func)
+    for (auto& inst : bb)
+      if (is_root(&inst))
+        mark_live(&inst);
+
+  // 深度优先搜索找出回边，回边所在块的终结指令和块本身都是活的。否则循环
+  // 退出条件的分支可能被判为死分支，改写后循环就永远出不去了
+  SmallPtrSet<BasicBlock*, 32> visited, onStack;
+  SmallVector<std::pair<BasicBlock*, succ_iterator>, 32> stack;
+  auto entry = &func.getEntryBlock();
+  visited.insert(entry);
+  onStack.insert(entry);
+  stack.push_back({ entry, succ_begin(entry) });
+  while (!stack.empty()) {
+    auto& [bb, iter] = stack.back();
+    if (iter == succ_end(bb)) {
+      onStack.erase(bb);
+      stack.pop_back();
+      continue;
+    }
+    auto succ = *iter++;
+    if (onStack.count(succ)) {
+      mark_live(bb->getTerminator());
+      mark_block_live(bb);
+    } else if (visited.insert(succ).second) {
+      onStack.insert(succ);
+      stack.push_back({ succ, succ_begin(succ) });
+    }
+  }
+
+  while (!mWork.empty() || !mNewLiveBlocks.empty()) {
+    while (!mWork.empty()) {
+      auto inst = mWork.pop_back_val();
+      for (auto& op : inst->operands())
+        if (auto opInst = dyn_cast<Instruction>(op))
+          mark_live(opInst);
+
+      // PHI 的值取决于从哪个前驱进入，所以各前驱块在控制流上都是活的
+      if (auto phi = dyn_cast<PHINode>(inst)) {
+        if (mPhiBlocks.insert(phi->getParent()).second)
+          for (auto pred : predecessors(phi->getParent()))
+            mark_block_live(pred);
+      }
+    }
+
+    // 新活块所控制依赖的分支是活的
+    if (mNewLiveBlocks.empty())
+      continue;
+    SmallVector<BasicBlock*, 32> deps;
+    ReverseIDFCalculator idf(mPdt);
+    idf.setDefiningBlocks(mNewLiveBlocks);
+    idf.calculate(deps);
+    mNewLiveBlocks.clear();
+    for (auto bb : deps)
+      mark_live(bb->getTerminator());
+  }
+}
+
+} // namespace
+
+PreservedAnalyses
+ADCE::run(Function& func, FunctionAnalysisManager& fam)
+{
+  int removedInsts = 0, foldedBranches = 0;
+
+  Marker marker(fam.getResult<PostDominatorTreeAnalysis>(func));
+  marker.mark(func);
+
+  // 死的条件分支和 switch 改写为跳到任一后继。没有活指令依赖它的走向，
+  // 而所有走向最终都汇合到同一个活块，所以选哪个后继都一样
+  for (auto& bb : func) {
+    auto term = bb.getTerminator();
+    auto br = dyn_cast<BranchInst>(term);
+    if ((br && br->isUnconditional()) || marker.live(term))
+      continue;
+
+    auto dest = *succ_begin(&bb);
+    bool kept = false;
+    for (auto succ : successors(&bb)) {
+      if (succ == dest && !kept)
+        kept = true;
+      else
+        succ->removePredecessor(&bb);
+    }
+    BranchInst::Create(dest, term);
+    term->eraseFromParent();
+    ++foldedBranches;
+  }
+
+  // 删除其余的死指令，它们之间可能互相引用，先统一断开
+  SmallVector<Instruction*, 64> dead;
+  for (auto& bb : func)
+    for (auto& inst : bb)
+      if (!inst.isTerminator() && !marker.live(&inst))
+        dead.push_back(&inst);
+  for (auto inst : dead)
+    inst->dropAllReferences();
+  for (auto inst : dead)
+    inst->eraseFromParent();
+  removedInsts = dead.size();
+
+  mOut << "ADCE running on " << func.getName() << "...\nTo eliminate "
+       << removedInsts << " instructions, fold " << foldedBranches
+       << " branches\n";
+
+  if (foldedBranches == 0) {
+    if (removedInsts == 0)
+      return PreservedAnalyses::all();
+    PreservedAnalyses pa;
+    pa.preserveSet<CFGAnalyses>();
+    return pa;
+  }
+  return PreservedAnalyses::none();
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/PassManager.h>
+#include <llvm/Support/raw_ostream.h>
+
+/**
+ * @brief 激进的死代码删除（Aggressive Dead Code Elimination）
+ *
+ * 与“没有使用者就删除”的普通 DCE 相反，先假定所有指令都是死的，再从根出发
+ * 标记活指令：
+ *
+ * - 有副作用的指令（store、可能写内存的调用等）和 ret 等终结指令是根；
+ * - 活指令的操作数是活的，活 PHI 的各前驱块在控制流上是活的；
+ * - 一个块在控制流上是活的，它所控制依赖的分支（即它在逆向 CFG 上的迭代
+ *   支配边界中各块的终结指令）就是活的；
+ * - 循环回边上的分支总是活的，因此不会删掉可能不终止的循环。
+ *
+ * 标记结束后，死的条件分支改写为无条件跳转，其余死指令全部删除。死分支
+ * 之后留下的空块交给后续的 CFG 化简处理。
+ */
+class ADCE : public llvm::PassInfoMixin<ADCE>
+{
+public:
+  explicit ADCE(llvm::raw_ostream& out)
+    : mOut(out)
+  {
+  }
+
+  llvm::PreservedAnalyses run(llvm::Function& func,
+                              llvm::FunctionAnalysisManager& fam);
+
+private:
+  llvm::raw_ostream& mOut;
+};
@@ -23,11 +23,12 @@ ConstantFolding::run(Module& mod, ModuleAnalysisManager& mam)
           auto constRhs = dyn_cast<ConstantInt>(rhs);
           switch (binOp->getOpcode()) {
             case Instruction::Add: {
-              // 若左右操作数均为整数常量，则进行常量折叠与use替换
+              // 若左右操作数均为整数常量，则进行常量折叠与use替换。按 APInt
+              // 计算，结果与指令的位宽一致，溢出时按补码回绕
               if (constLhs && constRhs) {
-                binOp->replaceAllUsesWith(ConstantInt::getSigned(
+                binOp->replaceAllUsesWith(ConstantInt::get(
                   binOp->getType(),
-                  constLhs->getSExtValue() + constRhs->getSExtValue()));
+                  constLhs->getValue() + constRhs->getValue()));
                 instToErase.push_back(binOp);
                 ++constFoldTimes;
               }
@@ -35,9 +36,9 @@ ConstantFolding::run(Module& mod, ModuleAnalysisManager& mam)
             }
             case Instruction::Sub: {
               if (constLhs && constRhs) {
-                binOp->replaceAllUsesWith(ConstantInt::getSigned(
+                binOp->replaceAllUsesWith(ConstantInt::get(
                   binOp->getType(),
-                  constLhs->getSExtValue() - constRhs->getSExtValue()));
+                  constLhs->getValue() - constRhs->getValue()));
                 instToErase.push_back(binOp);
                 ++constFoldTimes;
               }
@@ -45,20 +46,31 @@ ConstantFolding::run(Module& mod, ModuleAnalysisManager& mam)
             }
             case Instruction::Mul: {
               if (constLhs && constRhs) {
-                binOp->replaceAllUsesWith(ConstantInt::getSigned(
+                binOp->replaceAllUsesWith(ConstantInt::get(
                   binOp->getType(),
-                  constLhs->getSExtValue() * constRhs->getSExtValue()));
+                  constLhs->getValue() * constRhs->getValue()));
+                instToErase.push_back(binOp);
+                ++constFoldTimes;
+              }
+              break;
+            }
+            // 除以 0 以及 INT_MIN / -1 是未定义行为，不折叠
+            case Instruction::UDiv: {
+              if (constLhs && constRhs && !constRhs->isZero()) {
+                binOp->replaceAllUsesWith(ConstantInt::get(
+                  binOp->getType(),
+                  constLhs->getValue().udiv(constRhs->getValue())));
                 instToErase.push_back(binOp);
                 ++constFoldTimes;
               }
               break;
             }
-            case Instruction::UDiv:
             case Instruction::SDiv: {
-              if (constLhs && constRhs) {
-                binOp->replaceAllUsesWith(ConstantInt::getSigned(
+              if (constLhs && constRhs && !constRhs->isZero() &&
+                  !(constLhs->isMinValue(true) && constRhs->isMinusOne())) {
+                binOp->replaceAllUsesWith(ConstantInt::get(
                   binOp->getType(),
-                  constLhs->getSExtValue() / constRhs->getSExtValue()));
+                  constLhs->getValue().sdiv(constRhs->getValue())));
                 instToErase.push_back(binOp);
                 ++constFoldTimes;
               }
@@ -0,0 +1,120 @@
+#include "DSE.hpp"
+#include <llvm/IR/IntrinsicInst.h>
+
+using namespace llvm;
+
+namespace {
+
+/**
+ * @brief 判断 \p alloca 是否只写不读
+ *
+ * 是则把派生地址的指令按先定义后使用的顺序放进 \p derived ，把写入它们的
+ * store 和生命期标记放进 \p stores 。
+ */
+bool
+is_write_only(AllocaInst* alloca,
+              SmallVectorImpl<Instruction*>& derived,
+              SmallVectorImpl<Instruction*>& stores)
+{
+  SmallVector<Instruction*, 16> work{ alloca };
+  while (!work.empty()) {
+    auto ptr = work.pop_back_val();
+    for (auto user : ptr->users()) {
+      auto inst = cast<Instruction>(user);
+      if (auto store = dyn_cast<StoreInst>(inst)) {
+        // 地址本身被存到别处就是逃逸了
+        if (store->getValueOperand() == ptr || store->isVolatile())
+          return false;
+        stores.push_back(store);
+      } else if (isa<GetElementPtrInst>(inst) || isa<BitCastInst>(inst)) {
+        derived.push_back(inst);
+        work.push_back(inst);
+      } else if (auto ii = dyn_cast<IntrinsicInst>(inst)) {
+        if (!ii->isLifetimeStartOrEnd())
+          return false;
+        stores.push_back(ii);
+      } else
+        return false; // load、调用、比较等都可能读到其中的内容
+    }
+  }
+  return true;
+}
+
+/// 删除只写不读的 alloca，返回删除的指令数
+int
+remove_write_only_allocas(Function& func)
+{
+  SmallVector<AllocaInst*, 16> allocas;
+  for (auto& inst : func.getEntryBlock())
+    if (auto alloca = dyn_cast<AllocaInst>(&inst))
+      allocas.push_back(alloca);
+
+  int removed = 0;
+  for (auto alloca : allocas) {
+    SmallVector<Instruction*, 16> derived, stores;
+    if (!is_write_only(alloca, derived, stores))
+      continue;
+
+    for (auto inst : stores)
+      inst->eraseFromParent();
+    for (auto iter = derived.rbegin(); iter != derived.rend(); ++iter)
+      (*iter)->eraseFromParent();
+    alloca->eraseFromParent();
+    removed += stores.size() + derived.size() + 1;
+  }
+  return removed;
+}
+
+/// 删除块内被覆盖的 store，返回删除的指令数
+int
+remove_overwritten_stores(BasicBlock& bb)
+{
+  // 地址 -> 尚未被读过的最近一次 store
+  SmallDenseMap<Value*, StoreInst*, 16> pending;
+  int removed = 0;
+
+  for (auto& inst : make_early_inc_range(bb)) {
+    if (auto store = dyn_cast<StoreInst>(&inst)) {
+      if (!store->isSimple()) {
+        pending.clear();
+        continue;
+      }
+
+      auto ptr = store->getPointerOperand();
+      auto iter = pending.find(ptr);
+      if (iter != pending.end() &&
+          iter->second->getValueOperand()->getType() ==
+            store->getValueOperand()->getType()) {
+        iter->second->eraseFromParent();
+        ++removed;
+      }
+      pending[ptr] = store;
+      continue;
+    }
+
+    // 不同的地址可能别名，任何读内存的指令都让之前的 store 变得可见
+    if (inst.mayReadFromMemory())
+      pending.clear();
+  }
+
+  return removed;
+}
+
+} // namespace
+
+PreservedAnalyses
+DSE::run(Function& func, FunctionAnalysisManager& fam)
+{
+  int removed = remove_write_only_allocas(func);
+  for (auto& bb : func)
+    removed += remove_overwritten_stores(bb);
+
+  mOut << "DSE running on " << func.getName() << "...\nTo eliminate "
+       << removed << " instructions\n";
+
+  if (removed == 0)
+    return PreservedAnalyses::all();
+  PreservedAnalyses pa;
+  pa.preserveSet<CFGAnalyses>();
+  return pa;
+}
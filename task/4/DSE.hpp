@@ -0,0 +1,31 @@
+#pragma once
+
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/PassManager.h>
+#include <llvm/Support/raw_ostream.h>
+
+/**
+ * @brief 死存储删除（Dead Store Elimination）
+ *
+ * Mem2Reg 只能提升标量的 alloca，局部数组等仍留在内存里，写入它们的 store
+ * 都有副作用，ADCE 不会删除。本 pass 处理两种情况：
+ *
+ * - 只写不读的 alloca：经 GEP、bitcast 派生出的地址只被 store 写入，从未被
+ *   读取或逃逸，那么这些 store、地址计算连同 alloca 本身全部删除；
+ * - 被覆盖的 store：同一基本块中对同一地址的两次 store 之间没有任何可能
+ *   读内存的指令，前一次 store 是死的。
+ */
+class DSE : public llvm::PassInfoMixin<DSE>
+{
+public:
+  explicit DSE(llvm::raw_ostream& out)
+    : mOut(out)
+  {
+  }
+
+  llvm::PreservedAnalyses run(llvm::Function& func,
+                              llvm::FunctionAnalysisManager& fam);
+
+private:
+  llvm::raw_ostream& mOut;
+};
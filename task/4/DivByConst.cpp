@@ -0,0 +1,228 @@
+#include "DivByConst.hpp"
+
+using namespace llvm;
+
+namespace {
+
+/// CHOOSE_MULTIPLIER 的结果：商为 `(x * mMul) >> (N + mShift)`
+struct Magic
+{
+  APInt mMul;       ///< 乘数，可能有 N + 1 位
+  unsigned mShift;  ///< 取高 N 位之后还要右移的位数
+};
+
+/**
+ * @brief 论文图 6.2 的 CHOOSE_MULTIPLIER
+ *
+ * 对 N 位无符号的 \p d 和 \p prec 位的被除数，取 `l = ceil(log2 d)`，在
+ * `[2^(N+l) / d, (2^(N+l) + 2^(N+l-prec)) / d]` 中找位数最少的乘数。
+ */
+Magic
+choose_multiplier(const APInt& d, unsigned prec)
+{
+  unsigned n = d.getBitWidth(), l = d.ceilLogBase2();
+  unsigned width = 2 * n + 2;
+  auto dd = d.zext(width);
+  auto base = APInt::getOneBitSet(width, n + l);
+  auto low = base.udiv(dd);
+  auto high = (base + APInt::getOneBitSet(width, n + l - prec)).udiv(dd);
+
+  unsigned shift = l;
+  while (shift > 0 && low.lshr(1).ult(high.lshr(1))) {
+    low = low.lshr(1);
+    high = high.lshr(1);
+    --shift;
+  }
+  return { high, shift };
+}
+
+/// 在被改写的指令前生成替换序列
+class Expander
+{
+public:
+  explicit Expander(BinaryOperator* inst)
+    : mBuilder(inst)
+    , mTy(cast<IntegerType>(inst->getType()))
+    , mN(mTy->getBitWidth())
+    , mX(inst->getOperand(0))
+  {
+  }
+
+  Value* udiv(const APInt& d, bool exact);
+  Value* sdiv(const APInt& d, bool exact);
+  Value* urem(const APInt& d);
+  Value* srem(const APInt& d);
+
+private:
+  IRBuilder<> mBuilder;
+  IntegerType* mTy;
+  unsigned mN;
+  Value* mX;
+
+  Value* lshr(Value* val, unsigned amount)
+  {
+    return amount ? mBuilder.CreateLShr(val, amount) : val;
+  }
+
+  Value* ashr(Value* val, unsigned amount)
+  {
+    return amount ? mBuilder.CreateAShr(val, amount) : val;
+  }
+
+  /// `val * mul` 的高 N 位，\p isSigned 决定两者按有符号还是无符号扩展
+  Value* mul_high(Value* val, const APInt& mul, bool isSigned);
+};
+
+Value*
+Expander::mul_high(Value* val, const APInt& mul, bool isSigned)
+{
+  auto wide = IntegerType::get(mTy->getContext(), 2 * mN);
+  auto trunc = mul.trunc(mN);
+  Value* lhs;
+  Constant* rhs;
+  if (isSigned) {
+    lhs = mBuilder.CreateSExt(val, wide);
+    rhs = ConstantInt::get(wide, trunc.sext(2 * mN));
+  } else {
+    lhs = mBuilder.CreateZExt(val, wide);
+    rhs = ConstantInt::get(wide, trunc.zext(2 * mN));
+  }
+  auto prod = mBuilder.CreateMul(lhs, rhs);
+  return mBuilder.CreateTrunc(mBuilder.CreateLShr(prod, mN), mTy);
+}
+
+Value*
+Expander::udiv(const APInt& d, bool exact)
+{
+  if (d.isPowerOf2())
+    return lshr(mX, d.logBase2());
+
+  // 除数不小于 2^(N-1) 时商只能是 0 或 1
+  if (d.isNegative())
+    return mBuilder.CreateZExt(
+      mBuilder.CreateICmpUGE(mX, ConstantInt::get(mTy, d)), mTy);
+
+  auto magic = choose_multiplier(d, mN);
+  unsigned pre = 0;
+  if (exact || (magic.mMul.getActiveBits() > mN && d[0] == 0)) {
+    // 偶数除数先右移掉因子 2，被除数少了 pre 位，乘数一定放得进 N 位
+    pre = d.countTrailingZeros();
+    magic = choose_multiplier(d.lshr(pre), mN - pre);
+  }
+
+  if (magic.mMul.getActiveBits() <= mN)
+    return lshr(mul_high(lshr(mX, pre), magic.mMul, false), magic.mShift);
+
+  // 乘数有 N + 1 位：q = (t + ((x - t) >> 1)) >> (shift - 1)，其中 t 是
+  // x 乘以乘数低 N 位的高半部分，这样中间结果不会溢出
+  auto t = mul_high(mX, magic.mMul, false);
+  auto sum = mBuilder.CreateAdd(t, lshr(mBuilder.CreateSub(mX, t), 1));
+  return lshr(sum, magic.mShift - 1);
+}
+
+Value*
+Expander::sdiv(const APInt& d, bool exact)
+{
+  // d 为 INT_MIN 时 abs 不变，按无符号数看正好是 2^(N-1)
+  auto abs = d.abs();
+  Value* q;
+  if (abs.isOne())
+    q = mX;
+  else if (abs.isPowerOf2()) {
+    unsigned l = abs.logBase2();
+    if (exact)
+      q = ashr(mX, l);
+    else {
+      // 负数先加上 2^l - 1，使算术右移向零取整
+      auto bias = lshr(ashr(mX, l - 1), mN - l);
+      q = ashr(mBuilder.CreateAdd(mX, bias), l);
+    }
+  } else {
+    auto magic = choose_multiplier(abs, mN - 1);
+    auto t = mul_high(mX, magic.mMul, true);
+    // 乘数不小于 2^(N-1) 时按有符号数截断后是 m - 2^N，补上一个 x
+    if (magic.mMul.getActiveBits() >= mN)
+      t = mBuilder.CreateAdd(mX, t);
+    // 负数的商要加 1 才是向零取整
+    q = mBuilder.CreateSub(ashr(t, magic.mShift), ashr(mX, mN - 1));
+  }
+
+  return d.isNegative() ? mBuilder.CreateNeg(q) : q;
+}
+
+Value*
+Expander::urem(const APInt& d)
+{
+  if (d.isPowerOf2())
+    return mBuilder.CreateAnd(mX, ConstantInt::get(mTy, d - 1));
+  auto q = udiv(d, false);
+  auto prod = mBuilder.CreateMul(q, ConstantInt::get(mTy, d));
+  return mBuilder.CreateSub(mX, prod);
+}
+
+Value*
+Expander::srem(const APInt& d)
+{
+  auto q = sdiv(d, false);
+  auto prod = mBuilder.CreateMul(q, ConstantInt::get(mTy, d));
+  return mBuilder.CreateSub(mX, prod);
+}
+
+} // namespace
+
+PreservedAnalyses
+DivByConst::run(Function& func, FunctionAnalysisManager& fam)
+{
+  int rewritten = 0;
+
+  for (auto& bb : func) {
+    for (auto& inst : make_early_inc_range(bb)) {
+      auto binOp = dyn_cast<BinaryOperator>(&inst);
+      if (!binOp)
+        continue;
+      auto divisor = dyn_cast<ConstantInt>(binOp->getOperand(1));
+      auto ty = dyn_cast<IntegerType>(binOp->getType());
+      // 被除数也是常量的留给常量传播；除以 0 是未定义行为，保持原样
+      if (!divisor || !ty || ty->getBitWidth() < 2 ||
+          ty->getBitWidth() > 64 || divisor->isZero() ||
+          isa<Constant>(binOp->getOperand(0)))
+        continue;
+
+      Expander expander(binOp);
+      auto& d = divisor->getValue();
+      Value* result;
+      switch (binOp->getOpcode()) {
+        case Instruction::UDiv:
+          result = expander.udiv(d, binOp->isExact());
+          break;
+        case Instruction::SDiv:
+          result = expander.sdiv(d, binOp->isExact());
+          break;
+        case Instruction::URem:
+          result = expander.urem(d);
+          break;
+        case Instruction::SRem:
+          result = expander.srem(d);
+          break;
+        default:
+          continue;
+      }
+
+      // 除以 1 时结果就是被除数本身，不能把名字抢过去
+      if (result != binOp->getOperand(0))
+        result->takeName(binOp);
+      binOp->replaceAllUsesWith(result);
+      binOp->eraseFromParent();
+      ++rewritten;
+    }
+  }
+
+  mOut << "DivByConst running on " << func.getName() << "...\nTo rewrite "
+       << rewritten << " divisions\n";
+
+  if (rewritten == 0)
+    return PreservedAnalyses::all();
+  PreservedAnalyses pa;
+  pa.preserveSet<CFGAnalyses>();
+  return pa;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/PassManager.h>
+#include <llvm/Support/raw_ostream.h>
+
+/**
+ * @brief 除以常量的强度削减
+ *
+ * 把除数为常量的 udiv、sdiv、urem、srem 改写为乘法、移位序列，做法见
+ * Granlund 与 Montgomery 的 *Division by Invariant Integers using
+ * Multiplication*（1994）：
+ *
+ * - 除数为 2 的幂：无符号除法直接逻辑右移；有符号除法先给负数加上
+ *   `2^k - 1` 再算术右移，使结果向零取整；
+ * - 其它除数：取 `m ≈ 2^(N+s) / d`，商为 `x * m` 的高 N 位再右移 s 位，
+ *   m 放不进 N 位时按论文给出的修正序列计算；
+ * - 余数由 `x - q * d` 得到，无符号除以 2 的幂时直接按位与。
+ *
+ * 只处理 2 到 64 位的标量整数，乘法的高半部分通过扩展到两倍位宽再右移
+ * 得到，由后端选择合适的乘高位指令。
+ */
+class DivByConst : public llvm::PassInfoMixin<DivByConst>
+{
+public:
+  explicit DivByConst(llvm::raw_ostream& out)
+    : mOut(out)
+  {
+  }
+
+  llvm::PreservedAnalyses run(llvm::Function& func,
+                              llvm::FunctionAnalysisManager& fam);
+
+private:
+  llvm::raw_ostream& mOut;
+};
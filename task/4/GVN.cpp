@@ -0,0 +1,226 @@
+#include "GVN.hpp"
+#include <llvm/ADT/ScopedHashTable.h>
+#include <llvm/IR/Dominators.h>
+#include <memory>
+
+using namespace llvm;
+
+namespace {
+
+/// 表达式表的键，以指令本身代表它计算的表达式
+struct Expr
+{
+  Instruction* mInst;
+
+  /// 是否为可以编号的纯运算
+  static bool can_handle(Instruction* inst)
+  {
+    return (isa<BinaryOperator>(inst) || isa<CmpInst>(inst) ||
+            isa<CastInst>(inst) || isa<GetElementPtrInst>(inst) ||
+            isa<SelectInst>(inst)) &&
+           !inst->mayHaveSideEffects() && !inst->mayReadFromMemory();
+  }
+};
+
+} // namespace
+
+namespace llvm {
+
+template<>
+struct DenseMapInfo<Expr>
+{
+  static Expr getEmptyKey()
+  {
+    return { DenseMapInfo<Instruction*>::getEmptyKey() };
+  }
+
+  static Expr getTombstoneKey()
+  {
+    return { DenseMapInfo<Instruction*>::getTombstoneKey() };
+  }
+
+  static unsigned getHashValue(Expr expr)
+  {
+    auto inst = expr.mInst;
+    if (auto bo = dyn_cast<BinaryOperator>(inst)) {
+      // 可交换运算按地址排序操作数，a+b 与 b+a 落在同一个桶里
+      Value *lhs = bo->getOperand(0), *rhs = bo->getOperand(1);
+      if (bo->isCommutative() && lhs > rhs)
+        std::swap(lhs, rhs);
+      return hash_combine(bo->getOpcode(), lhs, rhs);
+    }
+    if (auto cmp = dyn_cast<CmpInst>(inst))
+      return hash_combine(cmp->getOpcode(),
+                          cmp->getPredicate(),
+                          cmp->getOperand(0),
+                          cmp->getOperand(1));
+    return hash_combine(
+      inst->getOpcode(),
+      inst->getType(),
+      hash_combine_range(inst->value_op_begin(), inst->value_op_end()));
+  }
+
+  static bool isEqual(Expr lhs, Expr rhs)
+  {
+    auto a = lhs.mInst, b = rhs.mInst;
+    if (a == getEmptyKey().mInst || a == getTombstoneKey().mInst ||
+        b == getEmptyKey().mInst || b == getTombstoneKey().mInst)
+      return a == b;
+    // nsw 等标志不影响在有定义时的结果，替换时再取交集
+    if (a->isIdenticalToWhenDefined(b))
+      return true;
+    auto bo = dyn_cast<BinaryOperator>(a);
+    return bo && bo->isCommutative() && a->getOpcode() == b->getOpcode() &&
+           a->getOperand(0) == b->getOperand(1) &&
+           a->getOperand(1) == b->getOperand(0);
+  }
+};
+
+} // namespace llvm
+
+namespace {
+
+/// 内存表的值
+struct MemValue
+{
+  Value* mValue;
+  unsigned mGeneration;
+};
+
+using ExprTable = ScopedHashTable<Expr, Instruction*>;
+using MemKey = std::pair<Value*, Type*>;
+using MemTable = ScopedHashTable<MemKey, MemValue>;
+
+class Numberer
+{
+public:
+  explicit Numberer(DominatorTree& dt)
+    : mDt(dt)
+  {
+  }
+
+  /// 沿支配树遍历整个函数
+  void run();
+
+  int mExprs{ 0 }; ///< 删除的表达式数
+  int mLoads{ 0 }; ///< 删除的 load 数
+
+private:
+  /// 支配树上的一个结点，作用域随结点出栈而结束
+  struct Frame
+  {
+    DomTreeNode* mNode;
+    DomTreeNode::const_iterator mChild;
+    unsigned mGeneration; ///< 处理完本块后的内存代数，子结点从这里开始
+    ExprTable::ScopeTy mExprScope;
+    MemTable::ScopeTy mMemScope;
+
+    Frame(DomTreeNode* node, ExprTable& exprs, MemTable& mems)
+      : mNode(node)
+      , mChild(node->begin())
+      , mGeneration(0)
+      , mExprScope(exprs)
+      , mMemScope(mems)
+    {
+    }
+  };
+
+  DominatorTree& mDt;
+  ExprTable mExprTable;
+  MemTable mMemTable;
+  unsigned mGeneration{ 0 };
+  SmallVector<Instruction*, 64> mDead;
+
+  void process(BasicBlock* bb);
+};
+
+void
+Numberer::run()
+{
+  SmallVector<std::unique_ptr<Frame>, 32> stack;
+  stack.push_back(
+    std::make_unique<Frame>(mDt.getRootNode(), mExprTable, mMemTable));
+  process(stack.back()->mNode->getBlock());
+  stack.back()->mGeneration = mGeneration;
+
+  while (!stack.empty()) {
+    auto& top = *stack.back();
+    if (top.mChild == top.mNode->end()) {
+      stack.pop_back();
+      continue;
+    }
+
+    auto child = *top.mChild++;
+    mGeneration = top.mGeneration;
+    // 从其它前驱进入时内存可能已被改写，之前的记录都不能再用
+    auto bb = child->getBlock();
+    if (bb->getSinglePredecessor() != top.mNode->getBlock())
+      ++mGeneration;
+    stack.push_back(std::make_unique<Frame>(child, mExprTable, mMemTable));
+    process(bb);
+    stack.back()->mGeneration = mGeneration;
+  }
+
+  for (auto inst : mDead)
+    inst->eraseFromParent();
+}
+
+void
+Numberer::process(BasicBlock* bb)
+{
+  for (auto& inst : *bb) {
+    if (Expr::can_handle(&inst)) {
+      if (auto prev = mExprTable.lookup({ &inst })) {
+        // 被替换的指令上没有的标志，保留下来的那条也不能再有
+        prev->andIRFlags(&inst);
+        inst.replaceAllUsesWith(prev);
+        mDead.push_back(&inst);
+        ++mExprs;
+      } else
+        mExprTable.insert({ &inst }, &inst);
+      continue;
+    }
+
+    if (auto load = dyn_cast<LoadInst>(&inst); load && load->isSimple()) {
+      MemKey key{ load->getPointerOperand(), load->getType() };
+      auto prev = mMemTable.lookup(key);
+      if (prev.mValue && prev.mGeneration == mGeneration) {
+        load->replaceAllUsesWith(prev.mValue);
+        mDead.push_back(load);
+        ++mLoads;
+      } else
+        mMemTable.insert(key, { load, mGeneration });
+      continue;
+    }
+
+    if (inst.mayWriteToMemory()) {
+      ++mGeneration;
+      // 刚写入的值可以直接转发给之后同一地址、同一类型的 load
+      if (auto store = dyn_cast<StoreInst>(&inst); store && store->isSimple()) {
+        auto value = store->getValueOperand();
+        MemKey key{ store->getPointerOperand(), value->getType() };
+        mMemTable.insert(key, { value, mGeneration });
+      }
+    }
+  }
+}
+
+} // namespace
+
+PreservedAnalyses
+GVN::run(Function& func, FunctionAnalysisManager& fam)
+{
+  Numberer numberer(fam.getResult<DominatorTreeAnalysis>(func));
+  numberer.run();
+
+  mOut << "GVN running on " << func.getName() << "...\nTo eliminate "
+       << numberer.mExprs + numberer.mLoads << " instructions ("
+       << numberer.mExprs << " expressions, " << numberer.mLoads
+       << " loads)\n";
+
+  if (numberer.mExprs + numberer.mLoads == 0)
+    return PreservedAnalyses::all();
+  PreservedAnalyses pa;
+  pa.preserveSet<CFGAnalyses>();
+  return pa;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/PassManager.h>
+#include <llvm/Support/raw_ostream.h>
+
+/**
+ * @brief 基于支配树的全局值编号（公共子表达式删除）
+ *
+ * 沿支配树先序遍历，维护随作用域进出的两张哈希表：
+ *
+ * - 表达式表：纯运算（算术、比较、类型转换、GEP、select）按操作码、类型和
+ *   操作数编号，可交换运算不区分操作数顺序。被支配的相同表达式直接替换为
+ *   支配它的那一个；
+ * - 内存表：地址与类型 -> 最近读到或写入的值。遇到可能写内存的指令时内存
+ *   代数加一，只有同一代数中的记录可以复用，load 因此可以被前面的 load
+ *   或 store 的值替换。进入有多个前驱的块时代数也加一，因为其它路径上
+ *   可能写过内存。
+ *
+ * 支配树取自分析管理器，通常就是 Mem2Reg 已经算好并保留下来的那一份。
+ */
+class GVN : public llvm::PassInfoMixin<GVN>
+{
+public:
+  explicit GVN(llvm::raw_ostream& out)
+    : mOut(out)
+  {
+  }
+
+  llvm::PreservedAnalyses run(llvm::Function& func,
+                              llvm::FunctionAnalysisManager& fam);
+
+private:
+  llvm::raw_ostream& mOut;
+};
@@ -0,0 +1,114 @@
+#include "Inliner.hpp"
+#include "Mem2Reg.hpp"
+#include "StaticCallCounter.hpp"
+#include <llvm/ADT/SCCIterator.h>
+#include <llvm/Analysis/CallGraph.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+
+using namespace llvm;
+
+namespace {
+
+/// 被调用者及其是否处在调用图的环上
+struct Callee
+{
+  Function* mFunc;
+  bool mRecursive;
+};
+
+/// 调用图的强连通分量按自底向上的顺序展开
+std::vector<Callee>
+bottom_up_order(CallGraph& cg)
+{
+  std::vector<Callee> order;
+  for (auto iter = scc_begin(&cg); !iter.isAtEnd(); ++iter) {
+    // 单个结点的分量只有调用自身时才有环，hasCycle 已经考虑了这一点
+    bool recursive = iter.hasCycle();
+    for (auto node : *iter)
+      if (auto func = node->getFunction())
+        order.push_back({ func, recursive });
+  }
+  return order;
+}
+
+/// 是否应当内联 \p func ，\p calls 为其静态调用点数
+bool
+worth_inlining(Function& func, unsigned calls)
+{
+  if (func.isDeclaration() || func.hasFnAttribute(Attribute::NoInline) ||
+      func.isVarArg())
+    return false;
+  auto size = func.getInstructionCount();
+  return size <= Inliner::kSmallSize ||
+         (calls == 1 && size <= Inliner::kSingleCallSize);
+}
+
+} // namespace
+
+PreservedAnalyses
+Inliner::run(Module& mod, ModuleAnalysisManager& mam)
+{
+  auto& calls = mam.getResult<StaticCallCounter>(mod);
+  auto order = bottom_up_order(mam.getResult<CallGraphAnalysis>(mod));
+  auto& fam =
+    mam.getResult<FunctionAnalysisManagerModuleProxy>(mod).getManager();
+
+  SetVector<Function*> callers;
+  int inlined = 0, erased = 0;
+  mOut << "Inliner running...\n";
+
+  for (auto [callee, recursive] : order) {
+    if (recursive || !worth_inlining(*callee, calls.lookup(callee)))
+      continue;
+
+    SmallVector<CallBase*, 8> sites;
+    for (auto user : callee->users()) {
+      auto call = dyn_cast<CallBase>(user);
+      if (call && call->getCalledFunction() == callee &&
+          call->getFunction() != callee)
+        sites.push_back(call);
+    }
+
+    int count = 0;
+    auto size = callee->getInstructionCount();
+    for (auto call : sites) {
+      auto caller = call->getFunction();
+      if (caller->getInstructionCount() + size > kCallerLimit)
+        continue;
+      // 不插入生命期标记，否则这个仓库的 Mem2Reg 不会提升这些 alloca
+      InlineFunctionInfo info;
+      auto result = InlineFunction(*call, info, false, nullptr, false);
+      if (!result.isSuccess())
+        continue;
+      callers.insert(caller);
+      ++count;
+    }
+    if (count == 0)
+      continue;
+    mOut << "  " << callee->getName() << ": " << size << " instructions, "
+         << count << " of " << sites.size() << " call sites inlined\n";
+    inlined += count;
+
+    if (callee->hasLocalLinkage() && callee->use_empty()) {
+      callers.remove(callee);
+      fam.clear(*callee, callee->getName());
+      callee->eraseFromParent();
+      ++erased;
+    }
+  }
+
+  // 内联进来的局部变量都是 alloca，就地提升为寄存器。调用者的控制流已经
+  // 变了，先让它缓存的分析全部失效
+  for (auto caller : callers) {
+    fam.invalidate(*caller, PreservedAnalyses::none());
+    auto pa = Mem2Reg().run(*caller, fam);
+    fam.invalidate(*caller, pa);
+  }
+
+  mOut << "To inline " << inlined << " call sites into " << callers.size()
+       << " functions, erase " << erased << " functions\n";
+
+  if (inlined == 0)
+    return PreservedAnalyses::all();
+  return PreservedAnalyses::none();
+}
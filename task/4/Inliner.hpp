@@ -0,0 +1,39 @@
+#pragma once
+
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/PassManager.h>
+#include <llvm/Support/raw_ostream.h>
+
+/**
+ * @brief 函数内联
+ *
+ * 按调用图自底向上（被调用者先于调用者）考察每个有函数体的函数，满足以下
+ * 条件之一时把它在其它函数中的所有直接调用点内联展开：
+ *
+ * - 指令数不超过 kSmallSize；
+ * - 按 StaticCallCounter 的统计只有一个调用点，且指令数不超过
+ *   kSingleCallSize。
+ *
+ * 处在调用图的环上（直接或间接递归）的函数不内联；调用者内联后超过
+ * kCallerLimit 条指令时跳过该调用点。被调用者的局部变量内联后成为调用者
+ * 入口块中的 alloca，因此每个发生了内联的调用者最后都会运行一次 Mem2Reg。
+ * 没有外部链接、也不再被使用的函数随之删除。
+ */
+class Inliner : public llvm::PassInfoMixin<Inliner>
+{
+public:
+  static constexpr unsigned kSmallSize = 60;
+  static constexpr unsigned kSingleCallSize = 600;
+  static constexpr unsigned kCallerLimit = 8000;
+
+  explicit Inliner(llvm::raw_ostream& out)
+    : mOut(out)
+  {
+  }
+
+  llvm::PreservedAnalyses run(llvm::Module& mod,
+                              llvm::ModuleAnalysisManager& mam);
+
+private:
+  llvm::raw_ostream& mOut;
+};
@@ -0,0 +1,495 @@
+#include "InstCombine.hpp"
+#include <array>
+#include <llvm/Analysis/ConstantFolding.h>
+#include <llvm/Transforms/Utils/Local.h>
+
+// InstructionWorklist 的调试输出需要 DEBUG_TYPE
+#define DEBUG_TYPE "instcombine"
+#include <llvm/Transforms/Utils/InstructionWorklist.h>
+
+using namespace llvm;
+
+namespace {
+
+enum Rule
+{
+  kFold,         ///< 操作数全为常量
+  kIdentity,     ///< x+0、x*1、x/1 等
+  kAnnihilate,   ///< x*0、x&0、x%1、0/x 等
+  kSelf,         ///< x-x、x^x、x&x、x==x 等
+  kCommute,      ///< 常量换到右边
+  kSubConst,     ///< x-C => x+(-C)
+  kReassoc,      ///< 常量重结合、外移
+  kCombineTerms, ///< x*C1+x*C2 => x*(C1+C2)
+  kNegate,       ///< x*-1、x+(0-y) 等
+  kBoolCmp,      ///< zext(b)!=0 => b 等
+  kInvertCmp,    ///< !(a<b) => a>=b
+  kCast,         ///< trunc(zext x) => x 等
+  kSelect,       ///< select c, x, x => x 等
+  kDead,         ///< 没有使用者的指令
+  kRuleCount,
+};
+
+constexpr const char* kRuleNames[kRuleCount] = {
+  "fold",          "identity",      "annihilate",    "self",
+  "commute",       "sub-const",     "reassoc",       "combine-terms",
+  "negate",        "bool-cmp",      "invert-cmp",    "cast",
+  "select",        "dead",
+};
+
+/// \p value 为 0-y 时返回 y
+Value*
+negated(Value* value)
+{
+  auto sub = dyn_cast<BinaryOperator>(value);
+  if (!sub || sub->getOpcode() != Instruction::Sub)
+    return nullptr;
+  auto c = dyn_cast<ConstantInt>(sub->getOperand(0));
+  return c && c->isZero() ? sub->getOperand(1) : nullptr;
+}
+
+/// 把 \p value 看作 x * \p coeff ，返回 x
+Value*
+split_term(Value* value, APInt& coeff)
+{
+  auto width = value->getType()->getIntegerBitWidth();
+  auto bo = dyn_cast<BinaryOperator>(value);
+  auto c = bo ? dyn_cast<ConstantInt>(bo->getOperand(1)) : nullptr;
+  if (c && bo->getOpcode() == Instruction::Mul) {
+    coeff = c->getValue();
+    return bo->getOperand(0);
+  }
+  if (c && bo->getOpcode() == Instruction::Shl && c->getValue().ult(width)) {
+    coeff = APInt::getOneBitSet(width, c->getZExtValue());
+    return bo->getOperand(0);
+  }
+  coeff = APInt(width, 1);
+  return value;
+}
+
+class Combiner
+{
+public:
+  explicit Combiner(Function& func)
+    : mDl(func.getParent()->getDataLayout())
+    , mBuilder(func.getContext(),
+               ConstantFolder(),
+               IRBuilderCallbackInserter(
+                 [this](Instruction* inst) { mWork.push(inst); }))
+  {
+  }
+
+  /// 处理到工作表为空
+  void run(Function& func);
+
+  int hits(Rule rule) const { return mHits[rule]; }
+
+private:
+  const DataLayout& mDl;
+  InstructionWorklist mWork;
+  /// 新建的指令自动进入工作表
+  IRBuilder<ConstantFolder, IRBuilderCallbackInserter> mBuilder;
+  std::array<int, kRuleCount> mHits{};
+
+  Value* hit(Rule rule, Value* value)
+  {
+    ++mHits[rule];
+    return value;
+  }
+
+  /// 删除已经没有使用者的 \p inst ，它的操作数可能随之变死
+  void erase(Instruction* inst);
+
+  /// 返回替换 \p inst 的值；原地修改时返回 \p inst 本身，没有可用规则时
+  /// 返回 nullptr
+  Value* visit(Instruction* inst);
+  Value* visit_binary(BinaryOperator* bo);
+  Value* visit_const_rhs(BinaryOperator* bo, ConstantInt* c);
+  Value* visit_icmp(ICmpInst* cmp);
+
+  /// 非常量运算数的重结合：常量外移、同类项合并
+  Value* reassociate(BinaryOperator* bo);
+
+  /// 布尔值 \p b 取反
+  Value* negate_bool(Value* b);
+};
+
+void
+Combiner::run(Function& func)
+{
+  // 工作表是栈，逆序压入后大致按程序顺序处理，操作数先于使用者
+  for (auto& bb : reverse(func))
+    for (auto& inst : reverse(bb))
+      mWork.push(&inst);
+
+  while (!mWork.isEmpty()) {
+    auto inst = mWork.removeOne();
+    if (!inst)
+      continue;
+
+    if (isInstructionTriviallyDead(inst)) {
+      ++mHits[kDead];
+      erase(inst);
+      continue;
+    }
+
+    mBuilder.SetInsertPoint(inst);
+    auto result = visit(inst);
+    if (!result)
+      continue;
+
+    mWork.pushUsersToWorkList(*inst);
+    if (result == inst) {
+      mWork.push(inst);
+      continue;
+    }
+    if (isa<Instruction>(result) && !result->hasName())
+      result->takeName(inst);
+    inst->replaceAllUsesWith(result);
+    erase(inst);
+  }
+}
+
+void
+Combiner::erase(Instruction* inst)
+{
+  for (auto& op : inst->operands())
+    if (auto opInst = dyn_cast<Instruction>(op))
+      mWork.push(opInst);
+  mWork.remove(inst);
+  inst->eraseFromParent();
+}
+
+Value*
+Combiner::visit(Instruction* inst)
+{
+  if (auto c = ConstantFoldInstruction(inst, mDl))
+    return hit(kFold, c);
+
+  if (auto bo = dyn_cast<BinaryOperator>(inst))
+    return visit_binary(bo);
+  if (auto cmp = dyn_cast<ICmpInst>(inst))
+    return visit_icmp(cmp);
+
+  if (auto sel = dyn_cast<SelectInst>(inst)) {
+    if (sel->getTrueValue() == sel->getFalseValue())
+      return hit(kSelect, sel->getTrueValue());
+    if (auto cond = dyn_cast<ConstantInt>(sel->getCondition()))
+      return hit(kSelect,
+                 cond->isOne() ? sel->getTrueValue() : sel->getFalseValue());
+    return nullptr;
+  }
+
+  // 布尔值参与算术时前端会先 zext 再 trunc 回来
+  if (auto trunc = dyn_cast<TruncInst>(inst)) {
+    auto ext = trunc->getOperand(0);
+    if ((isa<ZExtInst>(ext) || isa<SExtInst>(ext)) &&
+        cast<CastInst>(ext)->getSrcTy() == trunc->getType())
+      return hit(kCast, cast<CastInst>(ext)->getOperand(0));
+    return nullptr;
+  }
+  if (auto zext = dyn_cast<ZExtInst>(inst)) {
+    if (auto inner = dyn_cast<ZExtInst>(zext->getOperand(0)))
+      return hit(kCast,
+                 mBuilder.CreateZExt(inner->getOperand(0), zext->getType()));
+    return nullptr;
+  }
+
+  return nullptr;
+}
+
+Value*
+Combiner::visit_binary(BinaryOperator* bo)
+{
+  auto ty = bo->getType();
+  if (!ty->isIntegerTy())
+    return nullptr;
+  auto opc = bo->getOpcode();
+  auto lhs = bo->getOperand(0), rhs = bo->getOperand(1);
+
+  if (bo->isCommutative() && isa<Constant>(lhs) && !isa<Constant>(rhs)) {
+    bo->swapOperands();
+    return hit(kCommute, bo);
+  }
+
+  if (lhs == rhs) {
+    switch (opc) {
+      case Instruction::Sub:
+      case Instruction::Xor:
+      case Instruction::SRem:
+      case Instruction::URem:
+        return hit(kSelf, Constant::getNullValue(ty));
+      case Instruction::And:
+      case Instruction::Or:
+        return hit(kSelf, lhs);
+      // x 为 0 时是未定义行为，可以认为结果为 1
+      case Instruction::SDiv:
+      case Instruction::UDiv:
+        return hit(kSelf, ConstantInt::get(ty, 1));
+      default:
+        break;
+    }
+  }
+
+  if (auto c = dyn_cast<ConstantInt>(rhs))
+    return visit_const_rhs(bo, c);
+
+  if (auto c = dyn_cast<ConstantInt>(lhs); c && c->isZero()) {
+    switch (opc) {
+      case Instruction::SDiv:
+      case Instruction::UDiv:
+      case Instruction::SRem:
+      case Instruction::URem:
+      case Instruction::Shl:
+      case Instruction::LShr:
+      case Instruction::AShr:
+        return hit(kAnnihilate, c);
+      default:
+        break;
+    }
+  }
+
+  return reassociate(bo);
+}
+
+Value*
+Combiner::visit_const_rhs(BinaryOperator* bo, ConstantInt* c)
+{
+  auto ty = bo->getType();
+  auto opc = bo->getOpcode();
+  auto lhs = bo->getOperand(0);
+
+  if (c->isZero()) {
+    switch (opc) {
+      case Instruction::Add:
+      case Instruction::Sub:
+      case Instruction::Or:
+      case Instruction::Xor:
+      case Instruction::Shl:
+      case Instruction::LShr:
+      case Instruction::AShr:
+        return hit(kIdentity, lhs);
+      case Instruction::Mul:
+      case Instruction::And:
+        return hit(kAnnihilate, c);
+      default:
+        break;
+    }
+  }
+
+  // i1 中 1 与 -1 是同一个值，先按 1 处理
+  if (c->isOne()) {
+    switch (opc) {
+      case Instruction::Mul:
+      case Instruction::SDiv:
+      case Instruction::UDiv:
+        return hit(kIdentity, lhs);
+      case Instruction::SRem:
+      case Instruction::URem:
+        return hit(kAnnihilate, Constant::getNullValue(ty));
+      default:
+        break;
+    }
+  } else if (c->isMinusOne()) {
+    switch (opc) {
+      case Instruction::And:
+        return hit(kIdentity, lhs);
+      case Instruction::Or:
+        return hit(kAnnihilate, c);
+      case Instruction::SRem:
+        return hit(kAnnihilate, Constant::getNullValue(ty));
+      case Instruction::Mul:
+      case Instruction::SDiv:
+        return hit(kNegate, mBuilder.CreateNeg(lhs));
+      default:
+        break;
+    }
+  }
+
+  if (opc == Instruction::Xor && c->isOne() && ty->isIntegerTy(1))
+    if (auto cmp = dyn_cast<CmpInst>(lhs); cmp && cmp->hasOneUse())
+      return hit(kInvertCmp,
+                 mBuilder.CreateCmp(cmp->getInversePredicate(),
+                                    cmp->getOperand(0),
+                                    cmp->getOperand(1)));
+
+  if (opc == Instruction::Sub)
+    return hit(kSubConst,
+               mBuilder.CreateAdd(lhs, ConstantExpr::getNeg(c)));
+
+  // (x op C1) op C2 => x op (C1 op C2)
+  auto inner = dyn_cast<BinaryOperator>(lhs);
+  if (!inner || inner->getOpcode() != opc)
+    return nullptr;
+  auto innerC = dyn_cast<ConstantInt>(inner->getOperand(1));
+  if (!innerC)
+    return nullptr;
+  if (bo->isAssociative()) {
+    auto folded = ConstantFoldBinaryOpOperands(opc, innerC, c, mDl);
+    return hit(kReassoc,
+               mBuilder.CreateBinOp(opc, inner->getOperand(0), folded));
+  }
+  // 移位量相加，超出位宽时结果不再是简单的移位，不处理
+  if (bo->isShift()) {
+    unsigned width = ty->getIntegerBitWidth();
+    if (innerC->getValue().uge(width) || c->getValue().uge(width))
+      return nullptr;
+    auto amount = innerC->getZExtValue() + c->getZExtValue();
+    if (amount < width)
+      return hit(kReassoc,
+                 mBuilder.CreateBinOp(opc,
+                                      inner->getOperand(0),
+                                      ConstantInt::get(ty, amount)));
+  }
+  return nullptr;
+}
+
+Value*
+Combiner::reassociate(BinaryOperator* bo)
+{
+  auto opc = bo->getOpcode();
+  auto lhs = bo->getOperand(0), rhs = bo->getOperand(1);
+
+  if (opc == Instruction::Add || opc == Instruction::Sub) {
+    // 同类项：x*C1 ± x*C2 => x*(C1±C2)，单独的 x 看作 x*1，x<<k 看作 x*2^k
+    APInt lc, rc;
+    auto lx = split_term(lhs, lc), rx = split_term(rhs, rc);
+    if (lx == rx) {
+      auto coeff = opc == Instruction::Add ? lc + rc : lc - rc;
+      auto c = ConstantInt::get(bo->getType(), coeff);
+      return hit(kCombineTerms, mBuilder.CreateMul(lx, c));
+    }
+
+    // (x-y) + y => x，(x+y) - y => x，(x+y) - x => y
+    auto inner = dyn_cast<BinaryOperator>(lhs);
+    if (inner && opc == Instruction::Add &&
+        inner->getOpcode() == Instruction::Sub && inner->getOperand(1) == rhs)
+      return hit(kSelf, inner->getOperand(0));
+    if (inner && opc == Instruction::Sub &&
+        inner->getOpcode() == Instruction::Add) {
+      if (inner->getOperand(1) == rhs)
+        return hit(kSelf, inner->getOperand(0));
+      if (inner->getOperand(0) == rhs)
+        return hit(kSelf, inner->getOperand(1));
+    }
+
+    // x + (0-y) => x-y，x - (0-y) => x+y
+    if (auto y = negated(rhs))
+      return hit(kNegate,
+                 opc == Instruction::Add ? mBuilder.CreateSub(lhs, y)
+                                         : mBuilder.CreateAdd(lhs, y));
+    if (auto y = negated(lhs); y && opc == Instruction::Add)
+      return hit(kNegate, mBuilder.CreateSub(rhs, y));
+  }
+
+  // 常量外移：(x op C) op y => (x op y) op C，沿运算链一直移到最外层，与
+  // 其它常量相遇时由 visit_const_rhs 合并
+  auto withConst = [](Value* value, unsigned opc) -> BinaryOperator* {
+    auto inner = dyn_cast<BinaryOperator>(value);
+    if (inner && inner->getOpcode() == opc && inner->hasOneUse() &&
+        isa<ConstantInt>(inner->getOperand(1)))
+      return inner;
+    return nullptr;
+  };
+  if (bo->isAssociative()) {
+    if (auto inner = withConst(lhs, opc)) {
+      auto op = mBuilder.CreateBinOp(opc, inner->getOperand(0), rhs);
+      return hit(kReassoc,
+                 mBuilder.CreateBinOp(opc, op, inner->getOperand(1)));
+    }
+    if (auto inner = withConst(rhs, opc)) {
+      auto op = mBuilder.CreateBinOp(opc, lhs, inner->getOperand(0));
+      return hit(kReassoc,
+                 mBuilder.CreateBinOp(opc, op, inner->getOperand(1)));
+    }
+  } else if (opc == Instruction::Sub) {
+    // (x+C) - y => (x-y) + C，x - (y+C) => (x-y) + (-C)
+    if (auto inner = withConst(lhs, Instruction::Add)) {
+      auto op = mBuilder.CreateSub(inner->getOperand(0), rhs);
+      return hit(kReassoc, mBuilder.CreateAdd(op, inner->getOperand(1)));
+    }
+    if (auto inner = withConst(rhs, Instruction::Add)) {
+      auto op = mBuilder.CreateSub(lhs, inner->getOperand(0));
+      auto c = ConstantExpr::getNeg(cast<Constant>(inner->getOperand(1)));
+      return hit(kReassoc, mBuilder.CreateAdd(op, c));
+    }
+  }
+
+  return nullptr;
+}
+
+Value*
+Combiner::visit_icmp(ICmpInst* cmp)
+{
+  auto lhs = cmp->getOperand(0), rhs = cmp->getOperand(1);
+  if (lhs->getType()->isVectorTy())
+    return nullptr;
+
+  if (isa<Constant>(lhs) && !isa<Constant>(rhs)) {
+    cmp->swapOperands();
+    return hit(kCommute, cmp);
+  }
+
+  if (lhs == rhs)
+    return hit(kSelf, ConstantInt::get(cmp->getType(), cmp->isTrueWhenEqual()));
+
+  auto c = dyn_cast<ConstantInt>(rhs);
+  if (!c || !cmp->isEquality())
+    return nullptr;
+
+  // b 为 i1：b == 1、b != 0 即 b；b == 0、b != 1 即 !b。zext(b) 与 0、1
+  // 的比较同理，与其它常量比较时结果恒定
+  Value* b = nullptr;
+  if (lhs->getType()->isIntegerTy(1))
+    b = lhs;
+  else if (auto zext = dyn_cast<ZExtInst>(lhs);
+           zext && zext->getSrcTy()->isIntegerTy(1))
+    b = zext->getOperand(0);
+  if (!b)
+    return nullptr;
+
+  bool isEq = cmp->getPredicate() == ICmpInst::ICMP_EQ;
+  if (c->getValue().ugt(1))
+    return hit(kBoolCmp, ConstantInt::getBool(cmp->getType(), !isEq));
+  if (isEq == c->isOne())
+    return hit(kBoolCmp, b);
+  return negate_bool(b);
+}
+
+Value*
+Combiner::negate_bool(Value* b)
+{
+  if (auto cmp = dyn_cast<CmpInst>(b); cmp && cmp->hasOneUse())
+    return hit(kInvertCmp,
+               mBuilder.CreateCmp(cmp->getInversePredicate(),
+                                  cmp->getOperand(0),
+                                  cmp->getOperand(1)));
+  return hit(kBoolCmp, mBuilder.CreateNot(b));
+}
+
+} // namespace
+
+PreservedAnalyses
+InstCombine::run(Function& func, FunctionAnalysisManager& fam)
+{
+  auto before = func.getInstructionCount();
+  Combiner combiner(func);
+  combiner.run(func);
+  int removed = before - func.getInstructionCount();
+
+  mOut << "InstCombine running on " << func.getName() << "...\nTo eliminate "
+       << removed << " instructions\n";
+  bool changed = removed != 0;
+  for (int rule = 0; rule < kRuleCount; ++rule) {
+    if (auto count = combiner.hits(Rule(rule))) {
+      mOut << "  " << kRuleNames[rule] << ": " << count << '\n';
+      changed = true;
+    }
+  }
+
+  if (!changed)
+    return PreservedAnalyses::all();
+  PreservedAnalyses pa;
+  pa.preserveSet<CFGAnalyses>();
+  return pa;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/PassManager.h>
+#include <llvm/Support/raw_ostream.h>
+
+/**
+ * @brief 代数化简与指令合并
+ *
+ * 把函数中的全部指令放进工作表，逐条套用窥孔规则，被改写的指令的使用者、
+ * 新生成的指令以及可能变死的操作数重新入表，直到不动点。规则包括：
+ *
+ * - 操作数全为常量的指令直接折叠；
+ * - `x+0`、`x*1`、`x/1`、`x|0` 等恒等式，`x*0`、`x%1`、`0/x` 等零化式，
+ *   `x-x`、`x^x`、`x&x` 等自身运算；
+ * - 交换律运算把常量换到右边，`x-C` 改写为 `x+(-C)`，再把
+ *   `(x op C1) op C2` 重结合为 `x op (C1 op C2)`，常量沿运算链外移；
+ * - `x*C1 + x*C2` 合并为 `x*(C1+C2)`；
+ * - 布尔值的比较：`zext(b) != 0` 即 `b`，`zext(b) == 0` 即 `!b`，比较
+ *   结果取反时直接改用相反的谓词。
+ *
+ * 每条规则的命中次数打印到构造时给定的输出流。
+ */
+class InstCombine : public llvm::PassInfoMixin<InstCombine>
+{
+public:
+  explicit InstCombine(llvm::raw_ostream& out)
+    : mOut(out)
+  {
+  }
+
+  llvm::PreservedAnalyses run(llvm::Function& func,
+                              llvm::FunctionAnalysisManager& fam);
+
+private:
+  llvm::raw_ostream& mOut;
+};
@@ -0,0 +1,269 @@
+#include "LICM.hpp"
+#include <llvm/ADT/DepthFirstIterator.h>
+#include <llvm/Analysis/Loads.h>
+#include <llvm/Analysis/LoopInfo.h>
+#include <llvm/Analysis/ValueTracking.h>
+#include <llvm/IR/Dominators.h>
+#include <llvm/Transforms/Utils/SSAUpdater.h>
+
+using namespace llvm;
+
+namespace {
+
+/// 两个地址是否可能指向同一块内存。没有别名分析，只区分不同的 alloca 和
+/// 全局变量：它们各自是独立的对象，其它情况一律认为可能别名
+bool
+may_alias(const Value* a, const Value* b)
+{
+  auto objA = getUnderlyingObject(a), objB = getUnderlyingObject(b);
+  if (objA == objB)
+    return true;
+  auto identified = [](const Value* obj) {
+    return isa<AllocaInst>(obj) || isa<GlobalVariable>(obj);
+  };
+  return !identified(objA) || !identified(objB);
+}
+
+/// 单个循环的访存摘要
+struct MemInfo
+{
+  bool mHasCalls{ false };    ///< 有调用（不含无副作用的内建函数）
+  bool mCallsMemory{ false }; ///< 有可能读写内存的调用
+  SmallVector<StoreInst*, 16> mStores;
+  SmallVector<Instruction*, 32> mAccesses; ///< 所有 load 与 store
+
+  explicit MemInfo(Loop* loop)
+  {
+    for (auto bb : loop->blocks()) {
+      for (auto& inst : *bb) {
+        if (auto call = dyn_cast<CallBase>(&inst)) {
+          if (call->mayHaveSideEffects() || call->mayReadFromMemory())
+            mHasCalls = true;
+          if (call->mayReadOrWriteMemory())
+            mCallsMemory = true;
+        } else if (auto store = dyn_cast<StoreInst>(&inst)) {
+          mStores.push_back(store);
+          mAccesses.push_back(store);
+        } else if (isa<LoadInst>(&inst))
+          mAccesses.push_back(&inst);
+      }
+    }
+  }
+};
+
+/// 提升为寄存器后，在每个出口块开头写回
+class ExitStorer : public LoadAndStorePromoter
+{
+public:
+  ExitStorer(ArrayRef<const Instruction*> insts,
+             SSAUpdater& ssa,
+             Value* ptr,
+             Align align,
+             ArrayRef<BasicBlock*> exits)
+    : LoadAndStorePromoter(insts, ssa, ptr->getName())
+    , mSsa(ssa)
+    , mPtr(ptr)
+    , mAlign(align)
+    , mExits(exits)
+  {
+  }
+
+  void doExtraRewritesBeforeFinalDeletion() override
+  {
+    for (auto exit : mExits) {
+      auto value = mSsa.GetValueInMiddleOfBlock(exit);
+      new StoreInst(value, mPtr, false, mAlign, &*exit->getFirstInsertionPt());
+    }
+  }
+
+private:
+  SSAUpdater& mSsa;
+  Value* mPtr;
+  Align mAlign;
+  ArrayRef<BasicBlock*> mExits;
+};
+
+class LoopMover
+{
+public:
+  LoopMover(Loop* loop, LoopInfo& li, DominatorTree& dt)
+    : mLoop(loop)
+    , mLi(li)
+    , mDt(dt)
+    , mPreheader(loop->getLoopPreheader())
+    , mMem(loop)
+  {
+    mLoop->getUniqueExitBlocks(mExits);
+  }
+
+  /// 外提不变指令，返回移动的指令数
+  int hoist();
+
+  /// 把不变地址上的访存提升为寄存器，返回删除的 store 数
+  int promote();
+
+private:
+  Loop* mLoop;
+  LoopInfo& mLi;
+  DominatorTree& mDt;
+  BasicBlock* mPreheader;
+  MemInfo mMem;
+  SmallVector<BasicBlock*, 8> mExits;
+
+  bool guaranteed_to_execute(Instruction* inst) const;
+  bool can_hoist(Instruction* inst) const;
+};
+
+bool
+LoopMover::guaranteed_to_execute(Instruction* inst) const
+{
+  // 前面的调用可能不返回，此时提前执行就改变了可观察的行为
+  if (mMem.mHasCalls || mExits.empty())
+    return false;
+  for (auto exit : mExits)
+    if (!mDt.dominates(inst->getParent(), exit))
+      return false;
+  return true;
+}
+
+bool
+LoopMover::can_hoist(Instruction* inst) const
+{
+  if (isa<PHINode>(inst) || inst->isTerminator() || isa<AllocaInst>(inst))
+    return false;
+  if (!mLoop->hasLoopInvariantOperands(inst))
+    return false;
+
+  if (auto load = dyn_cast<LoadInst>(inst)) {
+    if (!load->isSimple() || mMem.mCallsMemory)
+      return false;
+    for (auto store : mMem.mStores)
+      if (may_alias(store->getPointerOperand(), load->getPointerOperand()))
+        return false;
+  } else if (inst->mayHaveSideEffects() || inst->mayReadFromMemory())
+    return false;
+
+  return isSafeToSpeculativelyExecute(inst) || guaranteed_to_execute(inst);
+}
+
+int
+LoopMover::hoist()
+{
+  int moved = 0;
+  auto insertPt = mPreheader->getTerminator();
+
+  // 按支配树先序遍历，操作数总是先于使用者被外提。子循环中的块在处理子
+  // 循环时已经外提过，不变量都在子循环的前置块里，即本循环的块中
+  for (auto node : depth_first(mDt.getNode(mLoop->getHeader()))) {
+    auto bb = node->getBlock();
+    if (mLi.getLoopFor(bb) != mLoop)
+      continue;
+    for (auto& inst : make_early_inc_range(*bb)) {
+      if (!can_hoist(&inst))
+        continue;
+      // 推测执行的指令可能在原本不会执行的路径上溢出，不能再保留 nsw 等标志
+      if (!guaranteed_to_execute(&inst))
+        inst.dropPoisonGeneratingFlags();
+      inst.moveBefore(insertPt);
+      ++moved;
+    }
+  }
+  return moved;
+}
+
+int
+LoopMover::promote()
+{
+  if (mMem.mCallsMemory || !mLoop->hasDedicatedExits())
+    return 0;
+
+  auto& dl = mPreheader->getModule()->getDataLayout();
+  SmallPtrSet<Value*, 8> tried;
+  int removed = 0;
+
+  for (auto store : mMem.mStores) {
+    auto ptr = store->getPointerOperand();
+    if (!tried.insert(ptr).second || !mLoop->isLoopInvariant(ptr))
+      continue;
+
+    // 在前置块中读初值、在出口写回都必须是安全的
+    auto obj = getUnderlyingObject(ptr);
+    auto global = dyn_cast<GlobalVariable>(obj);
+    if (!isa<AllocaInst>(obj) && !(global && !global->isConstant()))
+      continue;
+    auto ty = store->getValueOperand()->getType();
+    if (!isDereferenceablePointer(ptr, ty, dl))
+      continue;
+
+    // 所有可能别名的访存都必须恰好是这个地址上同类型的简单 load/store
+    SmallVector<Instruction*, 16> uses;
+    bool ok = true;
+    for (auto access : mMem.mAccesses) {
+      auto accessPtr = getLoadStorePointerOperand(access);
+      if (!may_alias(accessPtr, ptr))
+        continue;
+      bool simple = isa<LoadInst>(access) ? cast<LoadInst>(access)->isSimple()
+                                          : cast<StoreInst>(access)->isSimple();
+      if (accessPtr != ptr || getLoadStoreType(access) != ty || !simple) {
+        ok = false;
+        break;
+      }
+      uses.push_back(access);
+    }
+    if (!ok)
+      continue;
+
+    auto align = store->getAlign();
+    auto init = new LoadInst(ty,
+                             ptr,
+                             ptr->getName() + ".promoted",
+                             false,
+                             align,
+                             mPreheader->getTerminator());
+
+    SmallVector<PHINode*, 16> phis;
+    SSAUpdater ssa(&phis);
+    SmallVector<const Instruction*, 16> constUses(uses.begin(), uses.end());
+    ExitStorer storer(constUses, ssa, ptr, align, mExits);
+    ssa.AddAvailableValue(mPreheader, init);
+    for (auto use : uses)
+      removed += isa<StoreInst>(use);
+    storer.run(uses);
+  }
+
+  return removed;
+}
+
+} // namespace
+
+PreservedAnalyses
+LICM::run(Function& func, FunctionAnalysisManager& fam)
+{
+  auto& li = fam.getResult<LoopAnalysis>(func);
+  auto& dt = fam.getResult<DominatorTreeAnalysis>(func);
+
+  // 由内向外处理，内层外提到前置块的指令还有机会被外层继续外提
+  auto loops = li.getLoopsInPreorder();
+  bool changed = false;
+  for (auto iter = loops.rbegin(); iter != loops.rend(); ++iter) {
+    auto loop = *iter;
+    if (!loop->getLoopPreheader())
+      continue;
+
+    LoopMover mover(loop, li, dt);
+    int hoisted = mover.hoist();
+    int sunk = mover.promote();
+    changed |= hoisted || sunk;
+
+    mOut << "LICM on loop ";
+    loop->getHeader()->printAsOperand(mOut, false);
+    mOut << " in " << func.getName() << ": hoist " << hoisted
+         << " instructions, sink " << sunk << " stores\n";
+  }
+
+  if (!changed)
+    return PreservedAnalyses::all();
+  PreservedAnalyses pa;
+  pa.preserveSet<CFGAnalyses>();
+  return pa;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/PassManager.h>
+#include <llvm/Support/raw_ostream.h>
+
+/**
+ * @brief 循环不变量外提（Loop Invariant Code Motion）
+ *
+ * 从共享的分析管理器取得 LoopAnalysis 与支配树，由内向外处理每个带前置块
+ * （preheader）的循环：
+ *
+ * - 外提：操作数都在循环外定义、并且提前执行也安全的指令移到前置块末尾。
+ *   “安全”指可以推测执行（不会陷入、不会访问无效地址），或者所在块支配
+ *   所有出口且循环中没有调用；load 还要求循环中没有可能写到同一对象的
+ *   store 或调用；
+ * - 下沉：循环中对同一个不变地址的 load/store 提升为寄存器，在前置块读一次
+ *   初值，在每个出口块写回一次。要求循环中没有读写内存的调用、其它访存都
+ *   不可能与它别名，且出口块只有循环内的前驱。
+ *
+ * 每个循环移动的指令数打印到构造时给定的输出流。
+ */
+class LICM : public llvm::PassInfoMixin<LICM>
+{
+public:
+  explicit LICM(llvm::raw_ostream& out)
+    : mOut(out)
+  {
+  }
+
+  llvm::PreservedAnalyses run(llvm::Function& func,
+                              llvm::FunctionAnalysisManager& fam);
+
+private:
+  llvm::raw_ostream& mOut;
+};
@@ -912,24 +912,14 @@ promoteMemoryToRegister(Function& F, DominatorTree& DT)
 }
 
 PreservedAnalyses
-Mem2Reg::run(llvm::Module& mod, llvm::ModuleAnalysisManager& mam)
+Mem2Reg::run(Function& func, FunctionAnalysisManager& fam)
 {
-
-  FunctionAnalysisManager fam;
-  PassBuilder pb;
-  pb.registerFunctionAnalyses(fam);
-  bool flag = true;
-  for (Function& func : mod) {
-    if (func.isDeclaration())
-      continue;
-    auto& DT = fam.getResult<DominatorTreeAnalysis>(func);
-    if (promoteMemoryToRegister(func, DT)) {
-      flag = false;
-    }
-  }
-  if (flag) {
+  // 支配树从共享的分析管理器中获取，同一函数的后续 pass 可以直接复用
+  auto& DT = fam.getResult<DominatorTreeAnalysis>(func);
+  if (!promoteMemoryToRegister(func, DT))
     return PreservedAnalyses::all();
-  }
+
+  // 只增删了指令，没有改动控制流，支配树等 CFG 分析仍然有效
   PreservedAnalyses PA;
   PA.preserveSet<CFGAnalyses>();
   return PA;
@@ -0,0 +1,109 @@
+#include "PassProfiler.hpp"
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/Format.h>
+
+using namespace llvm;
+
+namespace {
+
+/// PassManager 和各种适配器只是容器，它们的用时已经计在内层 pass 上
+bool
+is_container(StringRef pass)
+{
+  return pass.contains("PassManager") || pass.contains("PassAdaptor");
+}
+
+/// 类型不符时返回 nullptr
+template<typename T>
+const T*
+ir_cast(const Any& ir)
+{
+  return any_cast<T>(&ir);
+}
+
+long
+count_insts(const Any& ir)
+{
+  if (auto func = ir_cast<const Function*>(ir))
+    return (*func)->getInstructionCount();
+  if (auto mod = ir_cast<const Module*>(ir))
+    return (*mod)->getInstructionCount();
+  return 0;
+}
+
+} // namespace
+
+void
+PassProfiler::register_callbacks(PassInstrumentationCallbacks& pic)
+{
+  pic.registerBeforeNonSkippedPassCallback([this](StringRef pass, Any ir) {
+    if (!is_container(pass))
+      before(pass, ir);
+  });
+  pic.registerAfterPassCallback(
+    [this](StringRef pass, Any ir, const PreservedAnalyses&) {
+      if (!is_container(pass))
+        after(std::chrono::steady_clock::now(), count_insts(ir));
+    });
+  // pass 删除了自己所在的 IR 单元，剩余指令数按 0 计
+  pic.registerAfterPassInvalidatedCallback(
+    [this](StringRef pass, const PreservedAnalyses&) {
+      if (!is_container(pass))
+        after(std::chrono::steady_clock::now(), 0);
+    });
+  pic.registerAnalysisInvalidatedCallback([this](StringRef, Any) {
+    if (!mLast.empty())
+      ++mStats[mLast].mInvalidated;
+  });
+}
+
+void
+PassProfiler::before(StringRef pass, const Any& ir)
+{
+  mStats[pass]; // 按首次运行的顺序占位
+  // 先数指令再计时，统计本身的开销不算进 pass 的用时
+  auto insts = count_insts(ir);
+  mFrames.push_back({ pass, std::chrono::steady_clock::now(), insts });
+}
+
+void
+PassProfiler::after(std::chrono::steady_clock::time_point end, long insts)
+{
+  auto frame = mFrames.back();
+  mFrames.pop_back();
+
+  std::chrono::duration<double, std::milli> ms = end - frame.mStart;
+  auto& stats = mStats[frame.mPass];
+  ++stats.mRuns;
+  stats.mMs += ms.count();
+  stats.mInstDelta += insts - frame.mInsts;
+  mLast = frame.mPass;
+}
+
+void
+PassProfiler::print(raw_ostream& out) const
+{
+  constexpr std::size_t kWidth = 70;
+
+  out << std::string(kWidth, '=') << '\n';
+  out << "     sysu-optimizer: pass statistics\n";
+  out << std::string(kWidth, '=') << '\n';
+  out << "  PASS                         RUNS     "
+         "WALL(ms)      DELTA    INVALID\n";
+  out << std::string(kWidth, '-') << '\n';
+
+  double total = 0;
+  for (auto& [pass, stats] : mStats) {
+    out << format("  %-24s %8u %12.3f %+10ld %10u\n",
+                  pass.str().c_str(),
+                  stats.mRuns,
+                  stats.mMs,
+                  stats.mInstDelta,
+                  stats.mInvalidated);
+    total += stats.mMs;
+  }
+
+  out << std::string(kWidth, '-') << '\n';
+  out << format("  TOTAL %41.3f\n\n", total);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <chrono>
+#include <llvm/ADT/MapVector.h>
+#include <llvm/IR/PassInstrumentation.h>
+#include <llvm/Support/raw_ostream.h>
+#include <vector>
+
+/**
+ * @brief 逐 pass 的性能统计
+ *
+ * 挂在 PassInstrumentationCallbacks 上，按 pass 的类名汇总运行次数、墙钟
+ * 用时、运行前后 IR 指令数的变化，以及它结束后被分析管理器失效的分析结果
+ * 个数（失效发生在 pass 返回之后，因此记在最近结束的 pass 名下）。函数级
+ * pass 在每个函数上的运行会累加到一起，PassManager 和适配器本身不计入。
+ */
+class PassProfiler
+{
+public:
+  void register_callbacks(llvm::PassInstrumentationCallbacks& pic);
+
+  /// 以表格形式打印汇总结果
+  void print(llvm::raw_ostream& out) const;
+
+private:
+  struct Stats
+  {
+    unsigned mRuns{ 0 };
+    double mMs{ 0 };
+    long mInstDelta{ 0 };
+    unsigned mInvalidated{ 0 };
+  };
+
+  /// 正在运行的 pass，嵌套运行时成栈
+  struct Frame
+  {
+    llvm::StringRef mPass;
+    std::chrono::steady_clock::time_point mStart;
+    long mInsts;
+  };
+
+  llvm::MapVector<llvm::StringRef, Stats> mStats; ///< 按首次运行的顺序排列
+  std::vector<Frame> mFrames;
+  llvm::StringRef mLast; ///< 最近结束的 pass
+
+  void before(llvm::StringRef pass, const llvm::Any& ir);
+  void after(std::chrono::steady_clock::time_point end, long insts);
+};
@@ -0,0 +1,409 @@
+#include "SCCP.hpp"
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/Analysis/ConstantFolding.h>
+#include <llvm/IR/CFG.h>
+
+using namespace llvm;
+
+namespace {
+
+/// 格值：未定 > 常量 > 非常量，合并只会往下走
+struct Lattice
+{
+  enum State : std::uint8_t
+  {
+    kUnknown,     ///< 尚未求出，可能是任何常量
+    kConstant,    ///< 在所有可行路径上都是 mConst
+    kOverdefined, ///< 不是常量
+  };
+
+  State mState{ kUnknown };
+  Constant* mConst{ nullptr };
+};
+
+/// 单个函数的求解器
+class Solver
+{
+public:
+  explicit Solver(Function& func)
+    : mDl(func.getParent()->getDataLayout())
+  {
+  }
+
+  /// 从入口块开始求解到不动点
+  void solve(Function& func);
+
+  bool executable(BasicBlock* bb) const { return mExecBlocks.count(bb); }
+
+  bool feasible(BasicBlock* from, BasicBlock* to) const
+  {
+    return mFeasibleEdges.count({ from, to });
+  }
+
+  /// 指令 \p inst 在所有可行路径上的常量值，不是常量时返回 nullptr
+  Constant* constant(Instruction* inst) const
+  {
+    auto iter = mValues.find(inst);
+    if (iter == mValues.end() || iter->second.mState != Lattice::kConstant)
+      return nullptr;
+    return iter->second.mConst;
+  }
+
+private:
+  const DataLayout& mDl;
+  DenseMap<Value*, Lattice> mValues;
+  SmallPtrSet<BasicBlock*, 32> mExecBlocks;
+  DenseSet<std::pair<BasicBlock*, BasicBlock*>> mFeasibleEdges;
+  SmallVector<BasicBlock*, 32> mBlockWork;
+  SmallVector<Instruction*, 64> mInstWork;
+
+  Lattice value_of(Value* value) const;
+
+  void mark_edge(BasicBlock* from, BasicBlock* to);
+  void mark_constant(Instruction* inst, Constant* c);
+  void mark_overdefined(Instruction* inst);
+  void push_users(Instruction* inst);
+
+  void visit(Instruction* inst);
+  void visit_phi(PHINode* phi);
+  void visit_select(SelectInst* sel);
+  void visit_terminator(Instruction* term);
+
+  /// 可达块中条件仍未定的分支会卡住求解，把条件降为非常量后重新推进
+  bool resolve_unknown_branches(Function& func);
+};
+
+Lattice
+Solver::value_of(Value* value) const
+{
+  // undef 和 poison 可以取任意值，保守地当作非常量
+  if (isa<UndefValue>(value))
+    return { Lattice::kOverdefined, nullptr };
+  if (auto c = dyn_cast<Constant>(value))
+    return { Lattice::kConstant, c };
+  if (isa<Instruction>(value)) {
+    auto iter = mValues.find(value);
+    return iter == mValues.end() ? Lattice() : iter->second;
+  }
+  return { Lattice::kOverdefined, nullptr }; // 函数参数等
+}
+
+void
+Solver::mark_edge(BasicBlock* from, BasicBlock* to)
+{
+  if (!mFeasibleEdges.insert({ from, to }).second)
+    return;
+
+  if (mExecBlocks.insert(to).second) {
+    mBlockWork.push_back(to);
+    return;
+  }
+
+  // 目标块已经可达，新的可行边只影响其中的 PHI
+  for (auto& phi : to->phis())
+    mInstWork.push_back(&phi);
+}
+
+void
+Solver::mark_constant(Instruction* inst, Constant* c)
+{
+  auto& lat = mValues[inst];
+  if (lat.mState == Lattice::kOverdefined)
+    return;
+  if (lat.mState == Lattice::kConstant) {
+    if (lat.mConst == c)
+      return;
+    lat = { Lattice::kOverdefined, nullptr };
+  } else
+    lat = { Lattice::kConstant, c };
+  push_users(inst);
+}
+
+void
+Solver::mark_overdefined(Instruction* inst)
+{
+  auto& lat = mValues[inst];
+  if (lat.mState == Lattice::kOverdefined)
+    return;
+  lat = { Lattice::kOverdefined, nullptr };
+  push_users(inst);
+}
+
+void
+Solver::push_users(Instruction* inst)
+{
+  for (auto user : inst->users()) {
+    auto userInst = cast<Instruction>(user);
+    if (executable(userInst->getParent()))
+      mInstWork.push_back(userInst);
+  }
+}
+
+void
+Solver::visit(Instruction* inst)
+{
+  if (auto phi = dyn_cast<PHINode>(inst))
+    return visit_phi(phi);
+  if (inst->isTerminator())
+    return visit_terminator(inst);
+  if (auto sel = dyn_cast<SelectInst>(inst))
+    return visit_select(sel);
+
+  // 访存、调用等指令的结果无法在编译期得知
+  if (!isa<BinaryOperator>(inst) && !isa<UnaryOperator>(inst) &&
+      !isa<CmpInst>(inst) && !isa<CastInst>(inst))
+    return mark_overdefined(inst);
+
+  auto& lat = mValues[inst];
+  if (lat.mState == Lattice::kOverdefined)
+    return;
+
+  SmallVector<Constant*, 2> ops;
+  for (auto& op : inst->operands()) {
+    auto opLat = value_of(op);
+    if (opLat.mState == Lattice::kOverdefined)
+      return mark_overdefined(inst);
+    if (opLat.mState == Lattice::kUnknown)
+      return; // 等操作数求出后会再次访问
+    ops.push_back(opLat.mConst);
+  }
+
+  Constant* c;
+  if (auto cmp = dyn_cast<CmpInst>(inst))
+    c = ConstantFoldCompareInstOperands(
+      cmp->getPredicate(), ops[0], ops[1], mDl);
+  else
+    c = ConstantFoldInstOperands(inst, ops, mDl);
+
+  // 除以零等情况会折叠出 poison 或常量表达式，这些都不当作常量
+  if (c && (isa<ConstantInt>(c) || isa<ConstantFP>(c) ||
+            isa<ConstantPointerNull>(c)))
+    mark_constant(inst, c);
+  else
+    mark_overdefined(inst);
+}
+
+void
+Solver::visit_phi(PHINode* phi)
+{
+  if (value_of(phi).mState == Lattice::kOverdefined)
+    return;
+
+  // 只汇合来自可行边的值，其余的前驱在这条路径上根本不会执行
+  Constant* c = nullptr;
+  for (unsigned i = 0; i < phi->getNumIncomingValues(); ++i) {
+    if (!feasible(phi->getIncomingBlock(i), phi->getParent()))
+      continue;
+    auto lat = value_of(phi->getIncomingValue(i));
+    if (lat.mState == Lattice::kUnknown)
+      continue;
+    if (lat.mState == Lattice::kOverdefined || (c && c != lat.mConst))
+      return mark_overdefined(phi);
+    c = lat.mConst;
+  }
+
+  if (c)
+    mark_constant(phi, c);
+}
+
+void
+Solver::visit_select(SelectInst* sel)
+{
+  auto cond = value_of(sel->getCondition());
+  if (cond.mState == Lattice::kUnknown)
+    return;
+
+  auto tval = value_of(sel->getTrueValue());
+  auto fval = value_of(sel->getFalseValue());
+
+  Lattice lat;
+  if (auto ci = dyn_cast_or_null<ConstantInt>(cond.mConst))
+    lat = ci->isOne() ? tval : fval;
+  else if (tval.mState == Lattice::kUnknown)
+    lat = fval;
+  else if (fval.mState == Lattice::kUnknown ||
+           (tval.mState == Lattice::kConstant && tval.mConst == fval.mConst))
+    lat = tval;
+  else
+    lat = { Lattice::kOverdefined, nullptr };
+
+  if (lat.mState == Lattice::kConstant)
+    mark_constant(sel, lat.mConst);
+  else if (lat.mState == Lattice::kOverdefined)
+    mark_overdefined(sel);
+}
+
+void
+Solver::visit_terminator(Instruction* term)
+{
+  auto bb = term->getParent();
+
+  if (auto br = dyn_cast<BranchInst>(term)) {
+    if (br->isUnconditional())
+      return mark_edge(bb, br->getSuccessor(0));
+
+    auto cond = value_of(br->getCondition());
+    if (cond.mState == Lattice::kUnknown)
+      return;
+    if (auto ci = dyn_cast_or_null<ConstantInt>(cond.mConst))
+      return mark_edge(bb, br->getSuccessor(ci->isOne() ? 0 : 1));
+    mark_edge(bb, br->getSuccessor(0));
+    mark_edge(bb, br->getSuccessor(1));
+    return;
+  }
+
+  if (auto sw = dyn_cast<SwitchInst>(term)) {
+    auto cond = value_of(sw->getCondition());
+    if (cond.mState == Lattice::kUnknown)
+      return;
+    if (auto ci = dyn_cast_or_null<ConstantInt>(cond.mConst))
+      return mark_edge(bb, sw->findCaseValue(ci)->getCaseSuccessor());
+    for (auto succ : successors(bb))
+      mark_edge(bb, succ);
+    return;
+  }
+
+  // 其它终结指令的去向无法判断，全部出边都可行
+  if (!term->getType()->isVoidTy())
+    mark_overdefined(term);
+  for (auto succ : successors(bb))
+    mark_edge(bb, succ);
+}
+
+bool
+Solver::resolve_unknown_branches(Function& func)
+{
+  bool changed = false;
+  for (auto& bb : func) {
+    if (!executable(&bb))
+      continue;
+
+    Value* cond = nullptr;
+    auto term = bb.getTerminator();
+    if (auto br = dyn_cast<BranchInst>(term)) {
+      if (br->isConditional())
+        cond = br->getCondition();
+    } else if (auto sw = dyn_cast<SwitchInst>(term))
+      cond = sw->getCondition();
+
+    if (cond && value_of(cond).mState == Lattice::kUnknown) {
+      // 条件只可能是指令：常量和参数的格值都不会是未定
+      mark_overdefined(cast<Instruction>(cond));
+      mInstWork.push_back(term);
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+void
+Solver::solve(Function& func)
+{
+  auto entry = &func.getEntryBlock();
+  mExecBlocks.insert(entry);
+  mBlockWork.push_back(entry);
+
+  do {
+    while (!mBlockWork.empty() || !mInstWork.empty()) {
+      while (!mInstWork.empty()) {
+        auto inst = mInstWork.pop_back_val();
+        if (executable(inst->getParent()))
+          visit(inst);
+      }
+      while (!mBlockWork.empty()) {
+        auto bb = mBlockWork.pop_back_val();
+        for (auto& inst : *bb)
+          visit(&inst);
+      }
+    }
+  } while (resolve_unknown_branches(func));
+}
+
+} // namespace
+
+PreservedAnalyses
+SCCP::run(Function& func, FunctionAnalysisManager& fam)
+{
+  int foldedInsts = 0, foldedBranches = 0, removedBlocks = 0;
+
+  Solver solver(func);
+  solver.solve(func);
+
+  // 可达块中格值为常量的指令替换为常量。这些指令都没有副作用，可以直接删除
+  for (auto& bb : func) {
+    if (!solver.executable(&bb))
+      continue;
+    for (auto& inst : make_early_inc_range(bb)) {
+      if (auto c = solver.constant(&inst)) {
+        inst.replaceAllUsesWith(c);
+        inst.eraseFromParent();
+        ++foldedInsts;
+      }
+    }
+  }
+
+  // 只剩一个可行去向的分支改写为无条件跳转，其余后继的 PHI 去掉这个前驱
+  for (auto& bb : func) {
+    if (!solver.executable(&bb))
+      continue;
+    auto term = bb.getTerminator();
+    if (term->getNumSuccessors() < 2)
+      continue;
+
+    BasicBlock* dest = nullptr;
+    bool single = true;
+    for (auto succ : successors(&bb)) {
+      if (!solver.feasible(&bb, succ))
+        continue;
+      if (dest && dest != succ)
+        single = false;
+      dest = succ;
+    }
+    if (!dest || !single)
+      continue;
+
+    bool kept = false;
+    for (auto succ : successors(&bb)) {
+      if (succ == dest && !kept)
+        kept = true;
+      else
+        succ->removePredecessor(&bb);
+    }
+    BranchInst::Create(dest, term);
+    term->eraseFromParent();
+    ++foldedBranches;
+  }
+
+  // 删除不可达的基本块
+  SmallVector<BasicBlock*, 16> dead;
+  for (auto& bb : func)
+    if (!solver.executable(&bb))
+      dead.push_back(&bb);
+  for (auto bb : dead) {
+    for (auto succ : successors(bb))
+      if (solver.executable(succ))
+        succ->removePredecessor(bb);
+    for (auto& inst : *bb)
+      if (!inst.use_empty())
+        inst.replaceAllUsesWith(PoisonValue::get(inst.getType()));
+  }
+  for (auto bb : dead)
+    bb->dropAllReferences();
+  for (auto bb : dead)
+    bb->eraseFromParent();
+  removedBlocks = dead.size();
+
+  mOut << "SCCP running on " << func.getName() << "...\nTo eliminate "
+       << foldedInsts << " instructions, fold " << foldedBranches
+       << " branches, remove " << removedBlocks << " blocks\n";
+
+  if (foldedBranches == 0 && removedBlocks == 0) {
+    if (foldedInsts == 0)
+      return PreservedAnalyses::all();
+    // 控制流没有改动，支配树等 CFG 分析仍然有效
+    PreservedAnalyses pa;
+    pa.preserveSet<CFGAnalyses>();
+    return pa;
+  }
+  return PreservedAnalyses::none();
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/PassManager.h>
+#include <llvm/Support/raw_ostream.h>
+
+/**
+ * @brief 稀疏条件常量传播（Sparse Conditional Constant Propagation）
+ *
+ * 给每个值维护一个三层的格（未定、常量、非常量），同时记录哪些控制流边可能
+ * 被执行，用值和基本块两个工作表推进到不动点。格值只降不升，所以每条指令
+ * 只会被重新求值常数次。求解结束后：
+ *
+ * - 格值为常量的指令替换为该常量并删除；
+ * - 只有一条可行出边的条件分支改写为无条件跳转；
+ * - 不可达的基本块整个删除。
+ *
+ * 与 ConstantFolding 相比，`(1+2)*3` 这样的链一次就能折叠完，并且 PHI 只
+ * 汇合来自可行边的值，因此能看穿由常量条件控制的分支。
+ */
+class SCCP : public llvm::PassInfoMixin<SCCP>
+{
+public:
+  explicit SCCP(llvm::raw_ostream& out)
+    : mOut(out)
+  {
+  }
+
+  llvm::PreservedAnalyses run(llvm::Function& func,
+                              llvm::FunctionAnalysisManager& fam);
+
+private:
+  llvm::raw_ostream& mOut;
+};
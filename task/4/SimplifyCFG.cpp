@@ -0,0 +1,176 @@
+#include "SimplifyCFG.hpp"
+#include <llvm/Analysis/DomTreeUpdater.h>
+#include <llvm/IR/CFG.h>
+#include <llvm/IR/Dominators.h>
+#include <llvm/Transforms/Utils/BasicBlockUtils.h>
+#include <llvm/Transforms/Utils/Local.h>
+
+using namespace llvm;
+
+namespace {
+
+/// \p other 与 \p cond 的关系：1 为等价，-1 为互反，0 为无法判断
+int
+same_condition(ICmpInst* cond, ICmpInst* other)
+{
+  auto pred = other->getPredicate();
+  bool swapped = other->getOperand(0) == cond->getOperand(1) &&
+                 other->getOperand(1) == cond->getOperand(0);
+  if (swapped)
+    pred = ICmpInst::getSwappedPredicate(pred);
+  else if (other->getOperand(0) != cond->getOperand(0) ||
+           other->getOperand(1) != cond->getOperand(1))
+    return 0;
+
+  if (pred == cond->getPredicate())
+    return 1;
+  if (pred == cond->getInversePredicate())
+    return -1;
+  return 0;
+}
+
+/// 把 \p value 在 \p bb 支配范围内的使用替换为 \p known ，返回替换的个数
+int
+replace_dominated_uses(Value* value,
+                       Constant* known,
+                       BasicBlock* bb,
+                       DominatorTree& dt)
+{
+  int replaced = 0;
+  for (auto& use : make_early_inc_range(value->uses())) {
+    auto user = cast<Instruction>(use.getUser());
+    // PHI 的使用发生在对应前驱的末尾
+    auto useBb = user->getParent();
+    if (auto phi = dyn_cast<PHINode>(user))
+      useBb = phi->getIncomingBlock(use);
+    if (dt.dominates(bb, useBb)) {
+      use.set(known);
+      ++replaced;
+    }
+  }
+  return replaced;
+}
+
+/// 条件传播，返回替换的使用个数
+int
+propagate_conditions(Function& func, DominatorTree& dt)
+{
+  auto& ctx = func.getContext();
+  int replaced = 0;
+  for (auto& bb : func) {
+    auto br = dyn_cast<BranchInst>(bb.getTerminator());
+    if (!br || br->isUnconditional() ||
+        br->getSuccessor(0) == br->getSuccessor(1))
+      continue;
+    auto cond = br->getCondition();
+    if (isa<Constant>(cond))
+      continue;
+
+    // 等价的比较都是操作数的使用者，从非常量的那个操作数找
+    auto cmp = dyn_cast<ICmpInst>(cond);
+    Value* anchor = nullptr;
+    if (cmp && !isa<Constant>(cmp->getOperand(0)))
+      anchor = cmp->getOperand(0);
+    else if (cmp && !isa<Constant>(cmp->getOperand(1)))
+      anchor = cmp->getOperand(1);
+
+    for (unsigned i = 0; i < 2; ++i) {
+      // 后继只有这一个前驱时，它支配的块都只能经由这条边到达
+      auto succ = br->getSuccessor(i);
+      if (succ->getSinglePredecessor() != &bb)
+        continue;
+      bool taken = i == 0;
+      auto known = ConstantInt::getBool(ctx, taken);
+      replaced += replace_dominated_uses(cond, known, succ, dt);
+
+      if (!anchor)
+        continue;
+      for (auto user : anchor->users()) {
+        auto other = dyn_cast<ICmpInst>(user);
+        if (!other || other == cmp || other->getFunction() != &func)
+          continue;
+        if (int same = same_condition(cmp, other)) {
+          known = ConstantInt::getBool(ctx, taken == (same > 0));
+          replaced += replace_dominated_uses(other, known, succ, dt);
+        }
+      }
+    }
+  }
+  return replaced;
+}
+
+/// 是否为循环头：有前驱被它支配，即存在回边
+bool
+is_loop_header(BasicBlock* bb, DominatorTree& dt)
+{
+  for (auto pred : predecessors(bb))
+    if (dt.dominates(bb, pred))
+      return true;
+  return false;
+}
+
+/// 是否为可以绕过的空块：除 PHI 外只有一条跳到别处的无条件跳转
+bool
+is_forwarding_block(BasicBlock& bb, DominatorTree& dt)
+{
+  if (&bb == &bb.getParent()->getEntryBlock())
+    return false;
+  auto br = dyn_cast<BranchInst>(bb.getTerminator());
+  if (!br || br->isConditional() || bb.getFirstNonPHIOrDbg() != br)
+    return false;
+  auto succ = br->getSuccessor(0);
+  return succ != &bb && !is_loop_header(succ, dt);
+}
+
+} // namespace
+
+PreservedAnalyses
+SimplifyCFG::run(Function& func, FunctionAnalysisManager& fam)
+{
+  DomTreeUpdater dtu(fam.getResult<DominatorTreeAnalysis>(func),
+                     DomTreeUpdater::UpdateStrategy::Eager);
+  auto blocksBefore = func.size();
+  int propagated = 0, folded = 0, forwarded = 0, merged = 0;
+
+  bool changed = true;
+  while (changed) {
+    propagated += propagate_conditions(func, dtu.getDomTree());
+    changed = false;
+
+    for (auto& bb : func) {
+      if (ConstantFoldTerminator(&bb, true, nullptr, &dtu)) {
+        ++folded;
+        changed = true;
+      }
+    }
+    changed |= removeUnreachableBlocks(func, &dtu);
+
+    for (auto& bb : make_early_inc_range(func)) {
+      if (is_forwarding_block(bb, dtu.getDomTree()) &&
+          TryToSimplifyUncondBranchFromEmptyBlock(&bb, &dtu)) {
+        ++forwarded;
+        changed = true;
+      } else if (MergeBlockIntoPredecessor(&bb, &dtu)) {
+        ++merged;
+        changed = true;
+      }
+    }
+  }
+
+  int removed = blocksBefore - func.size();
+  mOut << "SimplifyCFG running on " << func.getName() << "...\nTo eliminate "
+       << removed << " blocks (" << forwarded << " forwarded, " << merged
+       << " merged), fold " << folded << " branches, propagate " << propagated
+       << " conditions\n";
+
+  if (removed == 0 && folded == 0) {
+    if (propagated == 0)
+      return PreservedAnalyses::all();
+    PreservedAnalyses pa;
+    pa.preserveSet<CFGAnalyses>();
+    return pa;
+  }
+  PreservedAnalyses pa;
+  pa.preserve<DominatorTreeAnalysis>();
+  return pa;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/PassManager.h>
+#include <llvm/Support/raw_ostream.h>
+
+/**
+ * @brief 控制流图化简
+ *
+ * EmitIR 为每条 return 之后新建一个 `return_exit` 块，各种语句也会留下只有
+ * 一条跳转的空块。本 pass 反复执行以下化简直到不动点：
+ *
+ * - 条件传播：从分支 `br c, T, F` 进入 T（T 只有这一个前驱）后，T 支配的
+ *   范围内 c 恒为真，谓词与操作数相同或相反的比较也随之确定，嵌套在同一
+ *   条件下的内层 if 因此变成常量分支；
+ * - 条件为常量、两个目标相同的分支改为无条件跳转，不可达的块删除；
+ * - 只有一条无条件跳转的空块被绕过，前驱直接跳到它的后继（循环头前面的
+ *   空块保留，它是 LICM 需要的前置块）；
+ * - 只有一个前驱、且前驱只有它一个后继的块并入前驱。
+ *
+ * 修改控制流时通过 DomTreeUpdater 同步更新分析管理器中的支配树，因此支配
+ * 树在 pass 之后仍然有效，不需要重新计算。
+ */
+class SimplifyCFG : public llvm::PassInfoMixin<SimplifyCFG>
+{
+public:
+  explicit SimplifyCFG(llvm::raw_ostream& out)
+    : mOut(out)
+  {
+  }
+
+  llvm::PreservedAnalyses run(llvm::Function& func,
+                              llvm::FunctionAnalysisManager& fam);
+
+private:
+  llvm::raw_ostream& mOut;
+};
@@ -1,70 +1,166 @@
+#include <chrono>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/Verifier.h>
 #include <llvm/IRReader/IRReader.h>
 #include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/Format.h>
 #include <llvm/Support/raw_ostream.h>
+#include <sstream>
+#include <string>
+#include <vector>
 
+#include "ADCE.hpp"
 #include "ConstantFolding.hpp"
+#include "DSE.hpp"
+#include "DivByConst.hpp"
+#include "GVN.hpp"
+#include "InstCombine.hpp"
+#include "Inliner.hpp"
+#include "LICM.hpp"
 #include "Mem2Reg.hpp"
+#include "PassProfiler.hpp"
+#include "SCCP.hpp"
+#include "SimplifyCFG.hpp"
 #include "StaticCallCounter.hpp"
 #include "StaticCallCounterPrinter.hpp"
 
-void
-opt(llvm::Module& mod)
+/// 预设的优化级别，写法与 -passes= 相同
+constexpr const char* kO0 = "";
+constexpr const char* kO1 = "mem2reg,adce";
+constexpr const char* kO2 = "mem2reg,simplifycfg,inline,sccp,instcombine,gvn,"
+                            "divconst,licm,dse,adce,simplifycfg";
+
+/**
+ * @brief 优化器
+ *
+ * PassBuilder、各级分析管理器和 pass 流水线只构造一次，批量模式下所有编译
+ * 单元共用。每个模块优化完后清空分析结果的缓存，已注册的分析 pass 保留。
+ */
+class Optimizer
 {
-  using namespace llvm;
+public:
+  /// \p profiler 非空时，每个 pass 的运行情况都会记录到其中
+  explicit Optimizer(PassProfiler* profiler)
+    : mPb(nullptr, llvm::PipelineTuningOptions(), {}, &mPic)
+  {
+    if (profiler)
+      profiler->register_callbacks(mPic);
 
-  // 定义分析pass的管理器
-  LoopAnalysisManager lam;
-  FunctionAnalysisManager fam;
-  CGSCCAnalysisManager cgam;
-  ModuleAnalysisManager mam;
-  ModulePassManager mpm;
-
-  // 注册分析pass的管理器
-  PassBuilder pb;
-  pb.registerModuleAnalyses(mam);
-  pb.registerCGSCCAnalyses(cgam);
-  pb.registerFunctionAnalyses(fam);
-  pb.registerLoopAnalyses(lam);
-  pb.crossRegisterProxies(lam, fam, cgam, mam);
-
-  // 添加分析pass到管理器中
-  mam.registerPass([]() { return StaticCallCounter(); });
-
-  // 添加优化pass到管理器中
-  mpm.addPass(StaticCallCounterPrinter(llvm::errs()));
-  mpm.addPass(Mem2Reg());
-  mpm.addPass(ConstantFolding(llvm::errs()));
-  // 运行优化pass
-  mpm.run(mod, mam);
-}
+    // 注册分析pass的管理器
+    mPb.registerModuleAnalyses(mMam);
+    mPb.registerCGSCCAnalyses(mCgam);
+    mPb.registerFunctionAnalyses(mFam);
+    mPb.registerLoopAnalyses(mLam);
+    mPb.crossRegisterProxies(mLam, mFam, mCgam, mMam);
 
-int
-main(int argc, char** argv)
-{
-  if (argc != 3) {
-    std::cout << "Usage: " << argv[0] << " <input> <output>\n";
-    return -1;
+    // 添加分析pass到管理器中
+    mMam.registerPass([]() { return StaticCallCounter(); });
   }
 
-  llvm::LLVMContext ctx;
+  /**
+   * @brief 按逗号分隔的 pass 名构造流水线，遇到未知的名字时返回 false
+   *
+   * 同一个 pass 可以出现多次。相邻的函数级 pass 放进同一个
+   * FunctionPassManager，经适配器逐个函数运行，共用 mFam 中缓存的支配树等
+   * 分析，某个 pass 没有保留的分析会由管理器按函数失效。
+   */
+  bool parse(llvm::StringRef pipeline)
+  {
+    llvm::FunctionPassManager fpm;
+    auto flush = [&]() {
+      if (fpm.isEmpty())
+        return;
+      mMpm.addPass(llvm::createModuleToFunctionPassAdaptor(std::move(fpm)));
+      fpm = llvm::FunctionPassManager();
+    };
+
+    llvm::SmallVector<llvm::StringRef, 8> names;
+    pipeline.split(names, ',', -1, false);
+    for (auto name : names) {
+      name = name.trim();
+      if (name == "mem2reg")
+        fpm.addPass(Mem2Reg());
+      else if (name == "sccp")
+        fpm.addPass(SCCP(llvm::errs()));
+      else if (name == "adce")
+        fpm.addPass(ADCE(llvm::errs()));
+      else if (name == "dse")
+        fpm.addPass(DSE(llvm::errs()));
+      else if (name == "simplifycfg")
+        fpm.addPass(SimplifyCFG(llvm::errs()));
+      else if (name == "instcombine")
+        fpm.addPass(InstCombine(llvm::errs()));
+      else if (name == "gvn")
+        fpm.addPass(GVN(llvm::errs()));
+      else if (name == "divconst")
+        fpm.addPass(DivByConst(llvm::errs()));
+      else if (name == "licm")
+        fpm.addPass(LICM(llvm::errs()));
+      else if (name == "constfold") {
+        flush();
+        mMpm.addPass(ConstantFolding(llvm::errs()));
+      } else if (name == "inline") {
+        flush();
+        mMpm.addPass(Inliner(llvm::errs()));
+      } else if (name == "callcounter") {
+        flush();
+        mMpm.addPass(StaticCallCounterPrinter(llvm::errs()));
+      } else {
+        std::cout << "Error: unknown pass: " << name.str() << '\n';
+        return false;
+      }
+    }
+    flush();
+    return true;
+  }
+
+  void operator()(llvm::Module& mod)
+  {
+    // 运行优化pass
+    mMpm.run(mod, mMam);
 
+    // 缓存的分析结果以 IR 对象的地址为键，模块释放后必须丢弃
+    mLam.clear();
+    mFam.clear();
+    mCgam.clear();
+    mMam.clear();
+  }
+
+private:
+  // 定义分析pass的管理器
+  llvm::LoopAnalysisManager mLam;
+  llvm::FunctionAnalysisManager mFam;
+  llvm::CGSCCAnalysisManager mCgam;
+  llvm::ModuleAnalysisManager mMam;
+  llvm::ModulePassManager mMpm;
+  llvm::PassInstrumentationCallbacks mPic;
+  llvm::PassBuilder mPb;
+};
+
+/// 编译一个单元，返回值即单文件模式下的进程退出码
+int
+compile(const char* argv0,
+        const char* inPath,
+        const char* outPath,
+        llvm::LLVMContext& ctx,
+        Optimizer& opt)
+{
   llvm::SMDiagnostic err;
-  auto mod = llvm::parseIRFile(argv[1], err, ctx);
+  auto mod = llvm::parseIRFile(inPath, err, ctx);
   if (!mod) {
-    std::cout << "Error: unable to parse input file: " << argv[1] << '\n';
-    err.print(argv[0], llvm::errs());
+    std::cout << "Error: unable to parse input file: " << inPath << '\n';
+    err.print(argv0, llvm::errs());
     return -2;
   }
 
   std::error_code ec;
-  llvm::StringRef outPath(argv[2]);
   llvm::raw_fd_ostream outFile(outPath, ec);
   if (ec) {
-    std::cout << "Error: unable to open output file: " << argv[2] << '\n';
+    std::cout << "Error: unable to open output file: " << outPath << '\n';
     return -3;
   }
 
@@ -73,4 +169,105 @@ main(int argc, char** argv)
   mod->print(outFile, nullptr, false, true);
   if (llvm::verifyModule(*mod, &llvm::outs()))
     return 3;
+  return 0;
+}
+
+/// 批量模式：清单的每一行是一对“输入 输出”路径，空行和 # 开头的行忽略。
+/// 所有单元共用同一个 LLVMContext 和优化器，省去每个进程的启动开销。
+int
+batch(const char* argv0,
+      const char* manifestPath,
+      llvm::LLVMContext& ctx,
+      Optimizer& opt)
+{
+  std::ifstream manifest(manifestPath);
+  if (!manifest) {
+    std::cout << "Error: unable to open manifest: " << manifestPath << '\n';
+    return -2;
+  }
+
+  std::vector<std::pair<std::string, std::string>> units;
+  for (std::string line; std::getline(manifest, line);) {
+    std::istringstream iss(line);
+    std::string in, out;
+    if (!(iss >> in) || in[0] == '#')
+      continue;
+    if (!(iss >> out)) {
+      std::cout << "Error: missing output path for " << in << '\n';
+      return -2;
+    }
+    units.emplace_back(std::move(in), std::move(out));
+  }
+
+  using Clock = std::chrono::steady_clock;
+  int failed = 0;
+  auto begin = Clock::now();
+  for (std::size_t i = 0; i < units.size(); ++i) {
+    auto& [in, out] = units[i];
+    auto start = Clock::now();
+    auto ret = compile(argv0, in.c_str(), out.c_str(), ctx, opt);
+    std::chrono::duration<double, std::milli> ms = Clock::now() - start;
+    if (ret != 0)
+      ++failed;
+    llvm::errs() << "[" << i + 1 << "/" << units.size() << "] " << in
+                 << " -> " << out << "：返回 " << ret << "，用时 "
+                 << llvm::format("%.3f", ms.count()) << " ms\n";
+  }
+  std::chrono::duration<double, std::milli> total = Clock::now() - begin;
+  llvm::errs() << "共 " << units.size() << " 个单元，失败 " << failed
+               << " 个，总用时 " << llvm::format("%.3f", total.count())
+               << " ms\n";
+
+  return failed ? 1 : 0;
+}
+
+int
+main(int argc, char** argv)
+{
+  // 选项写在位置参数之前：-O0/-O1/-O2 选择预设流水线，-passes= 直接给出
+  // 流水线，-time-passes 在结束时打印各 pass 的统计
+  const char* pipeline = kO2;
+  bool timePasses = false;
+  int argi = 1;
+  for (; argi < argc && argv[argi][0] == '-'; ++argi) {
+    llvm::StringRef arg(argv[argi]);
+    if (arg == "-O0")
+      pipeline = kO0;
+    else if (arg == "-O1")
+      pipeline = kO1;
+    else if (arg == "-O2")
+      pipeline = kO2;
+    else if (arg.startswith("-passes="))
+      pipeline = argv[argi] + std::strlen("-passes=");
+    else if (arg == "-time-passes")
+      timePasses = true;
+    else
+      break; // --batch
+  }
+
+  if (argc - argi != 2) {
+    std::cout << "Usage: " << argv[0] << " [options] <input> <output>\n"
+              << "       " << argv[0] << " [options] --batch <manifest>\n"
+              << "Options:\n"
+              << "  -O0 | -O1 | -O2       预设流水线，默认 -O2\n"
+              << "  -passes=<p1,p2,...>   按顺序运行给定的 pass\n"
+              << "  -time-passes          打印各 pass 的用时等统计\n";
+    return -1;
+  }
+
+  llvm::LLVMContext ctx;
+  PassProfiler profiler;
+  Optimizer opt(timePasses ? &profiler : nullptr);
+  if (!opt.parse(pipeline))
+    return -1;
+
+  int ret;
+  if (std::string(argv[argi]) != "--batch")
+    ret = compile(argv[0], argv[argi], argv[argi + 1], ctx, opt);
+  else
+    ret = batch(argv[0], argv[argi + 1], ctx, opt);
+
+  if (timePasses)
+    profiler.print(llvm::errs());
+  return ret;
 }